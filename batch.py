@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+"""
+Batch mode of combined_script.py: run encode+solve jobs over a grid of graphs and k values with a bounded
+worker pool. Every job is a combined_script.py child process pinned to its own cores and limited in wall
+time, CPU time and memory. Results are appended to a JSONL file as soon as a job ends, so an interrupted
+batch resumes with the jobs that have no result yet.
+"""
+import glob
+import json
+import os
+import resource
+import signal
+import subprocess
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+
+def parse_k_range(spec):
+    """Expand a k specification like '5', '5-20' or '5,7,10-12' into a sorted list."""
+    ks = set()
+    for part in spec.split(','):
+        if '-' in part:
+            lo, hi = part.split('-', 1)
+            ks.update(range(int(lo), int(hi) + 1))
+        elif part:
+            ks.add(int(part))
+    if not ks or min(ks) <= 0:
+        raise ValueError(f"invalid k range '{spec}'")
+    return sorted(ks)
+
+
+def parse_memory(spec):
+    """Parse a memory size like '512M' or '4G' into bytes."""
+    units = {'K': 1 << 10, 'M': 1 << 20, 'G': 1 << 30, 'T': 1 << 40}
+    spec = spec.strip().upper()
+    if spec and spec[-1] in units:
+        return int(float(spec[:-1]) * units[spec[-1]])
+    return int(spec)
+
+
+def expand_jobs(patterns, k_spec, manifest):
+    """
+    Build the (graph, k) job list from globs and a k range, and/or a manifest with lines "<graph> <k-range>"
+    ('#' starts a comment). Duplicates are dropped, the order is kept.
+    """
+    jobs = []
+    if patterns:
+        ks = parse_k_range(k_spec) if k_spec else None
+        if ks is None:
+            raise ValueError('--k-range is required with glob patterns')
+        for pattern in patterns:
+            paths = sorted(glob.glob(pattern))
+            if not paths:
+                print(f"Warning: '{pattern}' matches no file", file=sys.stderr)
+            jobs.extend((path, k) for path in paths for k in ks)
+    if manifest:
+        with open(manifest) as f:
+            for lineno, line in enumerate(f, 1):
+                line = line.split('#', 1)[0].split()
+                if not line:
+                    continue
+                if len(line) != 2:
+                    raise ValueError(f"{manifest}:{lineno}: expected '<graph> <k-range>'")
+                jobs.extend((line[0], k) for k in parse_k_range(line[1]))
+    seen = set()
+    return [job for job in jobs if not (job in seen or seen.add(job))]
+
+
+def load_done(results_path):
+    """Keys (graph, k) of the jobs that already have a result line."""
+    done = set()
+    if os.path.exists(results_path):
+        with open(results_path) as f:
+            for line in f:
+                try:
+                    rec = json.loads(line)
+                    done.add((rec['graph'], rec['k']))
+                except (ValueError, KeyError):
+                    pass  # a line cut off by an interruption
+    return done
+
+
+def cpu_slices(jobs):
+    """Split the usable CPUs into one disjoint set per worker (shared round robin if there are too few)."""
+    cpus = sorted(os.sched_getaffinity(0))
+    if jobs >= len(cpus):
+        return [{cpus[i % len(cpus)]} for i in range(jobs)]
+    per = len(cpus) // jobs
+    return [set(cpus[i * per:(i + 1) * per]) for i in range(jobs)]
+
+
+def apply_limits(cpu_seconds, memory_bytes, cpus):
+    """
+    Limit the current process, called by a job child on itself before anything else runs; solver
+    processes inherit the limits. RLIMIT_CPU and RLIMIT_AS count per process.
+    """
+    if cpus:
+        os.sched_setaffinity(0, cpus)
+    if cpu_seconds:
+        resource.setrlimit(resource.RLIMIT_CPU, (cpu_seconds, cpu_seconds + 5))
+    if memory_bytes:
+        resource.setrlimit(resource.RLIMIT_AS, (memory_bytes, memory_bytes))
+
+
+def read_verdict(sol_path):
+    """SAT, UNSAT or None from the 's' line of a solution file."""
+    try:
+        with open(sol_path) as f:
+            for line in f:
+                if line.startswith('s '):
+                    status = line[2:].strip()
+                    return {'SATISFIABLE': 'SAT', 'UNSATISFIABLE': 'UNSAT'}.get(status)
+    except OSError:
+        pass
+    return None
+
+
+def terminate(proc, grace=2.0):
+    """
+    Stop a job: SIGTERM first, so the job can kill solvers running in sessions of their own (portfolio
+    members), then SIGKILL to its process group after the grace period.
+    @return The result of wait4 for the job.
+    """
+    try:
+        os.killpg(proc.pid, signal.SIGTERM)
+    except ProcessLookupError:
+        pass
+    end = time.monotonic() + grace
+    while time.monotonic() < end:
+        pid, wstatus, usage = os.wait4(proc.pid, os.WNOHANG)
+        if pid:
+            return pid, wstatus, usage
+        time.sleep(0.05)
+    try:
+        os.killpg(proc.pid, signal.SIGKILL)
+    except ProcessLookupError:
+        pass
+    return os.wait4(proc.pid, 0)
+
+
+class Batch:
+    """State shared by the workers: the results file, the running children and the CPU slices."""
+
+    def __init__(self, args, forward):
+        self.args = args
+        self.forward = forward
+        self.lock = threading.Lock()
+        self.running = set()
+        self.stopping = False
+        self.slices = cpu_slices(args.jobs)
+        self.free_slices = list(range(args.jobs))
+        self.results = open(args.results, 'a')
+
+    def run_job(self, graph, k):
+        """Run one job as a child process and append its result."""
+        with self.lock:
+            if self.stopping:
+                return
+            slot = self.free_slices.pop()
+        cpus = ','.join(map(str, sorted(self.slices[slot])))
+        base = os.path.splitext(os.path.basename(graph))[0]
+        sol_path = os.path.join(self.args.sol_dir, f"sol_{base}_{k}k.out")
+        log_path = os.path.join(self.args.sol_dir, 'batch_logs', f"{base}_{k}k.log")
+        cmd = [sys.executable, os.path.abspath(sys.argv[0]), *self.forward, '--job-cpus', cpus]
+        if self.args.cpu_limit:
+            cmd += ['--job-cpu-limit', str(self.args.cpu_limit)]
+        if self.args.mem_limit:
+            cmd += ['--job-mem-limit', str(parse_memory(self.args.mem_limit))]
+        cmd += [graph, str(k)]
+
+        if os.path.exists(sol_path):
+            os.remove(sol_path)  # a stale solution must not count for a job that dies early
+
+        start = time.monotonic()
+        status = None
+        with open(log_path, 'w') as log:
+            proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT, start_new_session=True)
+            with self.lock:
+                self.running.add(proc)
+            # wait4 reports the rusage of the child including the solvers it waited for
+            deadline = start + self.args.time_limit if self.args.time_limit else None
+            while True:
+                pid, wstatus, usage = os.wait4(proc.pid, os.WNOHANG)
+                if pid:
+                    break
+                if deadline and time.monotonic() > deadline:
+                    status = 'TIMEOUT'
+                    pid, wstatus, usage = terminate(proc)
+                    break
+                time.sleep(0.05)
+            proc.returncode = os.waitstatus_to_exitcode(wstatus)
+            with self.lock:
+                self.running.discard(proc)
+                self.free_slices.append(slot)
+                if self.stopping:
+                    return
+        wall = time.monotonic() - start
+        if status is None:
+            status = read_verdict(sol_path) or ('ERROR' if proc.returncode != 0 else 'UNKNOWN')
+        record = {
+            'graph': graph, 'k': k, 'status': status, 'exit': proc.returncode,
+            'wall': round(wall, 3), 'cpu': round(usage.ru_utime + usage.ru_stime, 3),
+            'maxrss_kb': usage.ru_maxrss, 'cpus': cpus,
+        }
+        with self.lock:
+            if self.stopping:
+                return
+            self.results.write(json.dumps(record) + '\n')
+            self.results.flush()
+            os.fsync(self.results.fileno())
+        print(f"[{status:>7}] {graph} k={k} {wall:.2f} s")
+
+    def stop(self):
+        """Kill all running jobs; their results are not written, so a resumed batch repeats them."""
+        with self.lock:
+            self.stopping = True
+            for proc in self.running:
+                try:
+                    os.killpg(proc.pid, signal.SIGTERM)
+                except ProcessLookupError:
+                    pass
+
+
+def run_batch(args, forward):
+    """
+    Run all jobs of the batch that have no result yet.
+    @param forward Options passed on to every job child, e.g. ['--kissat', './kissat', '--stream'].
+    """
+    try:
+        jobs = expand_jobs(args.batch, args.k_range, args.manifest)
+    except (OSError, ValueError) as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
+    done = load_done(args.results)
+    todo = [job for job in jobs if job not in done]
+    print(f"Batch: {len(jobs)} jobs, {len(jobs) - len(todo)} already done, {args.jobs} workers")
+    os.makedirs(os.path.join(args.sol_dir, 'batch_logs'), exist_ok=True)
+
+    batch = Batch(args, forward)
+    pool = ThreadPoolExecutor(max_workers=args.jobs)
+    try:
+        for future in [pool.submit(batch.run_job, graph, k) for graph, k in todo]:
+            future.result()
+    except BaseException:
+        batch.stop()
+        pool.shutdown(wait=True, cancel_futures=True)
+        raise
+    finally:
+        batch.results.close()
+    pool.shutdown()
+    print(f"Results written to '{args.results}'")
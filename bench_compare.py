@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+"""
+Compare a c2s_bench run against a stored baseline. Both are raw sample files (c2s_bench --raw, one row
+per instance, k, phase and repetition). For every instance, k and phase, the samples are compared with a
+one-sided Mann-Whitney U test or a bootstrap confidence interval of the median ratio. A phase regresses
+if it is significantly slower and its median grew by more than the threshold. The exit status is 1 if any
+phase regressed, so the comparison can gate a change.
+
+    bench_compare.py save bench_raw.csv                 # store as bench_baselines/baseline.csv
+    bench_compare.py compare bench_raw.csv              # compare against it
+"""
+import argparse
+import csv
+import math
+import os
+import random
+import shutil
+import statistics
+import sys
+from functools import lru_cache
+
+DEFAULT_DIR = 'bench_baselines'
+DEFAULT_NAME = 'baseline'
+
+
+def load_samples(path):
+    """Read a raw sample file into {(instance, k, phase): [seconds, ...]}, keeping the file order."""
+    samples = {}
+    with open(path, newline='') as f:
+        for row in csv.DictReader(f):
+            key = (row['instance'], int(row['k']), row['phase'])
+            samples.setdefault(key, []).append(float(row['seconds']))
+    return samples
+
+
+@lru_cache(maxsize=None)
+def _u_count(n, m, u):
+    """Number of orderings of n and m distinct samples whose U statistic of the first group is u."""
+    if u < 0:
+        return 0
+    if n == 0 or m == 0:
+        return 1 if u == 0 else 0
+    # the largest sample is from the first group (it beats all m) or from the second
+    return _u_count(n - 1, m, u - m) + _u_count(n, m - 1, u)
+
+
+def mann_whitney_greater(new, old):
+    """
+    One-sided Mann-Whitney U test of 'new tends to be larger than old'.
+    Exact for small samples without ties, normal approximation with tie correction otherwise.
+    @return p-value
+    """
+    n, m = len(new), len(old)
+    pooled = sorted([(x, 0) for x in new] + [(x, 1) for x in old])
+    ranks = [0.0] * len(pooled)
+    ties = []
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for t in range(i, j + 1):
+            ranks[t] = (i + j) / 2 + 1
+        if j > i:
+            ties.append(j - i + 1)
+        i = j + 1
+    rank_sum = sum(r for r, (_, group) in zip(ranks, pooled) if group == 0)
+    u = rank_sum - n * (n + 1) / 2
+    if not ties and n <= 20 and m <= 20:
+        total = math.comb(n + m, n)
+        return sum(_u_count(n, m, v) for v in range(int(u), n * m + 1)) / total
+    mean = n * m / 2
+    n_all = n + m
+    var = n * m / 12 * ((n_all + 1) - sum(t ** 3 - t for t in ties) / (n_all * (n_all - 1)))
+    if var <= 0:
+        return 1.0
+    z = (u - mean - 0.5) / math.sqrt(var)  # continuity correction
+    return 0.5 * math.erfc(z / math.sqrt(2))
+
+
+def bootstrap_ratio_ci(new, old, rounds=2000, confidence=0.95, seed=1):
+    """Percentile bootstrap confidence interval of median(new) / median(old)."""
+    rng = random.Random(seed)
+    ratios = []
+    for _ in range(rounds):
+        a = statistics.median(rng.choices(new, k=len(new)))
+        b = statistics.median(rng.choices(old, k=len(old)))
+        if b > 0:
+            ratios.append(a / b)
+    ratios.sort()
+    if not ratios:
+        return 1.0, 1.0
+    tail = (1 - confidence) / 2
+    return ratios[int(tail * (len(ratios) - 1))], ratios[int((1 - tail) * (len(ratios) - 1))]
+
+
+def compare(baseline, current, args):
+    """
+    Compare every key present in both runs and print one line per key.
+    @return Number of regressions.
+    """
+    regressions = 0
+    print(f"{'instance':<24} {'k':>4} {'phase':<6} {'base_s':>10} {'new_s':>10} {'change':>8} "
+          f"{'p / CI':>17}  verdict")
+    for key in sorted(baseline.keys() & current.keys()):
+        old, new = baseline[key], current[key]
+        old_median, new_median = statistics.median(old), statistics.median(new)
+        if old_median < args.min_time:
+            continue
+        change = new_median / old_median - 1
+        if args.test == 'mannwhitney':
+            p = mann_whitney_greater(new, old)
+            significant = p < args.alpha
+            # the same test the other way round tells improvements apart from noise
+            faster = mann_whitney_greater(old, new) < args.alpha
+            stat = f"p={p:.4f}"
+        else:
+            low, high = bootstrap_ratio_ci(new, old, confidence=1 - args.alpha)
+            significant = low > 1
+            faster = high < 1
+            stat = f"[{low:.3f},{high:.3f}]"
+        if significant and change > args.threshold:
+            verdict = 'REGRESSION'
+            regressions += 1
+        elif faster and -change > args.threshold:
+            verdict = 'faster'
+        else:
+            verdict = 'same'
+        instance, k, phase = key
+        print(f"{instance:<24} {k:>4} {phase:<6} {old_median:>10.6f} {new_median:>10.6f} {change:>+8.1%} "
+              f"{stat:>17}  {verdict}")
+    missing = sorted(baseline.keys() - current.keys())
+    if missing:
+        print(f"Note: {len(missing)} baseline entries are not in the new run", file=sys.stderr)
+    return regressions
+
+
+def parse_threshold(text):
+    """A relative threshold like '5%' or '0.05'."""
+    return float(text[:-1]) / 100 if text.endswith('%') else float(text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Store c2s_bench baselines and compare runs against them.")
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    save = sub.add_parser('save', help='Store a raw sample file as a baseline')
+    save.add_argument('raw', help='Raw samples of c2s_bench --raw')
+    save.add_argument('--dir', default=DEFAULT_DIR, help=f"Baseline directory (default: {DEFAULT_DIR})")
+    save.add_argument('--name', default=DEFAULT_NAME, help=f"Baseline name (default: {DEFAULT_NAME})")
+
+    cmp_ = sub.add_parser('compare', help='Compare a raw sample file against a baseline')
+    cmp_.add_argument('raw', help='Raw samples of c2s_bench --raw')
+    cmp_.add_argument('--dir', default=DEFAULT_DIR, help=f"Baseline directory (default: {DEFAULT_DIR})")
+    cmp_.add_argument('--name', default=DEFAULT_NAME, help=f"Baseline name (default: {DEFAULT_NAME})")
+    cmp_.add_argument('--baseline', help='Baseline file, instead of <dir>/<name>.csv')
+    cmp_.add_argument('--test', choices=['mannwhitney', 'bootstrap'], default='mannwhitney',
+                      help='Significance test (default: mannwhitney)')
+    cmp_.add_argument('--alpha', type=float, default=0.01,
+                      help='Significance level; the bootstrap uses a 1-alpha interval (default: 0.01)')
+    cmp_.add_argument('--threshold', type=parse_threshold, default=0.05,
+                      help="Smallest median slowdown counted as a regression, e.g. '5%%' (default: 5%%)")
+    cmp_.add_argument('--min-time', type=float, default=0.001,
+                      help='Skip phases whose baseline median is below this many seconds (default: 0.001)')
+    args = parser.parse_args()
+
+    path = os.path.join(args.dir, args.name + '.csv')
+    if args.command == 'save':
+        os.makedirs(args.dir, exist_ok=True)
+        shutil.copyfile(args.raw, path)
+        print(f"Baseline saved to '{path}'")
+        return
+    try:
+        baseline = load_samples(args.baseline or path)
+        current = load_samples(args.raw)
+    except (OSError, KeyError, ValueError) as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(2)
+    regressions = compare(baseline, current, args)
+    if regressions:
+        print(f"{regressions} regression(s) above {args.threshold:.0%}")
+        sys.exit(1)
+    print("No regressions")
+
+
+if __name__ == '__main__':
+    main()
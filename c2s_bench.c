@@ -0,0 +1,452 @@
+/**
+ * @file c2s_bench.c
+ * @author Michael Helm
+ * @brief Benchmark of graph parsing and DIMACS emission over .col files and synthetic graphs, run by `make bench`.
+ * @date 2026-10-16
+ *
+ * Every (graph, k) pair is read and encoded once for warm-up and then reps times. Each repetition is
+ * timed per phase through the phase hook of c2s_encode_dimacs_observed(). The process is pinned to one CPU,
+ * and every input file is read once before the first repetition, so it comes from the page cache.
+ * The summary CSV has median and p95 per phase; the optional raw CSV has every sample for bench_compare.py.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libcolor2sat.h"
+
+char *progName = "<not set>";
+
+/**
+ * Prints formatted error messages to stderr and terminates with EXIT_FAILURE.
+ * Global variables: progName.
+ * @param msg The error message as a formatted string, like in fprintf(...).
+ * @param ... Variable number of arguments for the formatted string msg.
+ */
+#define ERROR_EXIT( msg, ... )                                         \
+    {                                                                  \
+        fprintf(stderr, "[%s] [%s] ERROR: " msg, progName, strerror(errno), ##__VA_ARGS__); \
+        exit(EXIT_FAILURE);                                            \
+    }
+
+#define MAX_KS 32
+
+/* Measured phases: parsing, the encoder phases, and the whole emission */
+enum { B_PARSE, B_ALO, B_AMO, B_EDGES, B_FLUSH, B_EMIT, B_PHASES };
+
+static const char *const phaseNames[B_PHASES] = { "parse", "alo", "amo", "edges", "flush", "emit" };
+
+/* Long options without a short form */
+enum { OPT_CPU = 256, OPT_IO, OPT_CNF, OPT_SYNTHETIC, OPT_SEED, OPT_RAW, OPT_ENCODING };
+
+/**
+ * Benchmark settings from the command line.
+ */
+typedef struct {
+    long ks[MAX_KS];
+    int numKs;
+    int reps;
+    C2sIoMode io;
+    int encoding;
+    const char *cnf;
+    FILE *csv;
+    FILE *raw;
+} Bench;
+
+/**
+ * Start time and output offset of every encoder phase, filled in by on_phase().
+ */
+typedef struct {
+    double start[C2S_PHASE_DONE + 1];
+    unsigned long long bytes[C2S_PHASE_DONE + 1];
+} PhaseTimes;
+
+/**
+ * Print usage and exit.
+ */
+static void usage(void);
+
+/**
+ * @return Seconds on the monotonic clock.
+ */
+static double now(void);
+
+/**
+ * C2sPhaseFn recording the start time and output offset of each phase into a PhaseTimes.
+ */
+static void on_phase(void *user, int phase, unsigned long long bytes);
+
+/**
+ * Benchmark one graph file for all k.
+ * @param b The settings.
+ * @param name Instance name in the CSV.
+ * @param path The .col file.
+ */
+static void bench_file(const Bench *b, const char *name, const char *path);
+
+/**
+ * Read a file once and discard the data, so the timed reads find it in the page cache.
+ */
+static void warm_page_cache(const char *path);
+
+/**
+ * Reset the peak RSS of this process (Linux 4.0+); ignored where not supported.
+ */
+static void reset_peak_rss(void);
+
+/**
+ * @return VmHWM of this process in KiB, or -1.
+ */
+static long peak_rss_kb(void);
+
+/**
+ * Write a G(n,m) random graph to a temporary .col file: m edges between distinct random endpoints,
+ * drawn with splitmix64 from seed.
+ * @return Path of the file, to be unlinked and freed by the caller.
+ */
+static char *write_gnm(int n, long m, unsigned long long seed);
+
+/**
+ * Nearest-rank percentile of sorted samples.
+ */
+static double percentile(const double *sorted, int count, double p);
+
+/**
+ * qsort(3) comparator of double.
+ */
+static int cmp_double(const void *a, const void *b);
+
+int main(int argc, char *argv[]) {
+    progName = argv[0];
+
+    Bench b = { .ks = { 5, 15, 30 }, .numKs = 3, .reps = 5, .io = C2S_IO_AUTO, .cnf = "/dev/null" };
+    const char *csvFile = "bench.csv";
+    const char *rawFile = NULL;
+    const char *synthetic = NULL;
+    unsigned long long seed = 1;
+    int cpu = -1;
+    char *endptr = NULL;
+    static const struct option longOpts[] = {
+        { "k",         required_argument, NULL, 'k' },
+        { "reps",      required_argument, NULL, 'r' },
+        { "output",    required_argument, NULL, 'o' },
+        { "raw",       required_argument, NULL, OPT_RAW },
+        { "cpu",       required_argument, NULL, OPT_CPU },
+        { "io",        required_argument, NULL, OPT_IO },
+        { "cnf",       required_argument, NULL, OPT_CNF },
+        { "synthetic", required_argument, NULL, OPT_SYNTHETIC },
+        { "seed",      required_argument, NULL, OPT_SEED },
+        { "encoding",  required_argument, NULL, OPT_ENCODING },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "k:r:o:", longOpts, NULL)) != -1) {
+        switch (opt) {
+        case 'k': {
+            b.numKs = 0;
+            char *p = optarg;
+            do {
+                if (b.numKs == MAX_KS)
+                    usage();
+                b.ks[b.numKs] = strtol(p, &endptr, 10);
+                if (endptr == p || b.ks[b.numKs] <= 0 || (*endptr != ',' && *endptr != '\0'))
+                    usage();
+                b.numKs++;
+                p = endptr + 1;
+            } while (*endptr == ',');
+            break;
+        }
+        case 'r':
+            b.reps = (int)strtol(optarg, &endptr, 10);
+            if (*endptr != '\0' || b.reps < 1)
+                usage();
+            break;
+        case 'o':
+            csvFile = optarg;
+            break;
+        case OPT_RAW:
+            rawFile = optarg;
+            break;
+        case OPT_CPU:
+            cpu = (int)strtol(optarg, &endptr, 10);
+            if (*endptr != '\0' || cpu < 0)
+                usage();
+            break;
+        case OPT_IO:
+            if (strcmp(optarg, "auto") == 0)
+                b.io = C2S_IO_AUTO;
+            else if (strcmp(optarg, "uring") == 0)
+                b.io = C2S_IO_URING;
+            else if (strcmp(optarg, "thread") == 0)
+                b.io = C2S_IO_THREAD;
+            else if (strcmp(optarg, "sync") == 0)
+                b.io = C2S_IO_SYNC;
+            else
+                usage();
+            break;
+        case OPT_CNF:
+            b.cnf = optarg;
+            break;
+        case OPT_SYNTHETIC:
+            synthetic = optarg;
+            break;
+        case OPT_SEED:
+            seed = strtoull(optarg, &endptr, 10);
+            if (*endptr != '\0')
+                usage();
+            break;
+        case OPT_ENCODING:
+            b.encoding = c2s_encoding_parse(optarg);
+            if (b.encoding < 0)
+                usage();
+            break;
+        default:
+            usage();
+        }
+    }
+    if (optind == argc && synthetic == NULL)
+        usage();
+
+    /* one CPU for the whole run, by default the last one we may use */
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        if (cpu < 0) {
+            for (int c = CPU_SETSIZE - 1; c >= 0 && cpu < 0; c--)
+                if (CPU_ISSET(c, &set))
+                    cpu = c;
+        }
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) < 0) {
+            ERROR_EXIT("Cannot pin to CPU %d\n", cpu);
+        }
+    }
+
+    b.csv = fopen(csvFile, "w");
+    if (b.csv == NULL) {
+        ERROR_EXIT("Error opening %s\n", csvFile);
+    }
+    fprintf(b.csv, "instance,k,phase,reps,median_s,p95_s,mb_s,clauses_s,bytes,clauses,peak_rss_kb\n");
+    if (rawFile) {
+        b.raw = fopen(rawFile, "w");
+        if (b.raw == NULL) {
+            ERROR_EXIT("Error opening %s\n", rawFile);
+        }
+        fprintf(b.raw, "instance,k,phase,rep,seconds\n");
+    }
+    fprintf(stderr, "%-24s %5s %-6s %10s %10s %9s %12s\n", "instance", "k", "phase", "median_s", "p95_s", "MB/s",
+            "clauses/s");
+
+    for (int i = optind; i < argc; i++) {
+        const char *base = strrchr(argv[i], '/');
+        char name[256];
+        snprintf(name, sizeof(name), "%s", base ? base + 1 : argv[i]);
+        char *dot = strrchr(name, '.');
+        if (dot)
+            *dot = '\0';
+        bench_file(&b, name, argv[i]);
+    }
+
+    /* synthetic graphs: comma separated n:m pairs */
+    for (const char *p = synthetic; p && *p;) {
+        int n = (int)strtol(p, &endptr, 10);
+        if (*endptr != ':')
+            usage();
+        long m = strtol(endptr + 1, &endptr, 10);
+        if (n < 2 || m < 0 || (*endptr != ',' && *endptr != '\0'))
+            usage();
+        p = *endptr == ',' ? endptr + 1 : endptr;
+        char *path = write_gnm(n, m, seed);
+        char name[64];
+        snprintf(name, sizeof(name), "gnm_%d_%ld", n, m);
+        bench_file(&b, name, path);
+        unlink(path);
+        free(path);
+    }
+
+    if (fclose(b.csv) != 0 || (b.raw && fclose(b.raw) != 0)) {
+        ERROR_EXIT("Error writing the results\n%s", "");
+    }
+    return EXIT_SUCCESS;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: %s [-k <k,k,...>] [-r <reps>] [-o <bench.csv>] [--raw <raw.csv>] [--cpu <n>] "
+                    "[--io auto|uring|thread|sync] [--cnf <path>] [--synthetic <n:m,...>] [--seed <s>] "
+                    "[--encoding <variant>] [<graph.col> ...]\n"
+                    "Times parsing and emitting every graph for every k and writes median and p95 per phase to a CSV\n"
+                    "--cnf sets where the CNF goes (default /dev/null), --synthetic adds seeded G(n,m) graphs\n",
+            progName);
+    exit(EXIT_FAILURE);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void on_phase(void *user, int phase, unsigned long long bytes) {
+    PhaseTimes *t = user;
+    t->start[phase] = now();
+    t->bytes[phase] = bytes;
+}
+
+static void bench_file(const Bench *b, const char *name, const char *path) {
+    struct stat st;
+    if (stat(path, &st) < 0) {
+        ERROR_EXIT("Error opening file %s\n", path);
+    }
+    warm_page_cache(path);
+
+    double *samples = malloc((size_t)B_PHASES * b->reps * sizeof(*samples));
+    if (samples == NULL) {
+        ERROR_EXIT("Out of memory\n%s", "");
+    }
+    for (int ki = 0; ki < b->numKs; ki++) {
+        long k = b->ks[ki];
+        unsigned long long bytes[B_PHASES] = { 0 };
+        long long clauses[B_PHASES] = { 0 };
+        reset_peak_rss();
+        /* repetition 0 is the warm-up and not recorded */
+        for (int r = 0; r <= b->reps; r++) {
+            C2sGraph *g = NULL;
+            double start = now();
+            int rc = c2s_graph_read(path, &g, NULL);
+            double parse = now() - start;
+            if (rc != C2S_OK) {
+                ERROR_EXIT("Reading %s failed: %s.\n", path, c2s_strerror(rc));
+            }
+            int fd = open(b->cnf, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            if (fd < 0) {
+                ERROR_EXIT("Error opening %s\n", b->cnf);
+            }
+            PhaseTimes t;
+            rc = c2s_encode_dimacs_observed(g, k, b->encoding, fd, b->io, on_phase, &t);
+            if (rc != C2S_OK || close(fd) < 0) {
+                ERROR_EXIT("Encoding %s failed: %s.\n", path, c2s_strerror(rc));
+            }
+            if (r > 0) {
+                double *s = samples + (r - 1);
+                s[B_PARSE * b->reps] = parse;
+                for (int p = C2S_PHASE_ALO; p < C2S_PHASE_DONE; p++)
+                    s[(B_ALO + p) * b->reps] = t.start[p + 1] - t.start[p];
+                s[B_EMIT * b->reps] = t.start[C2S_PHASE_DONE] - t.start[C2S_PHASE_ALO];
+            }
+            bytes[B_PARSE] = st.st_size;
+            for (int p = C2S_PHASE_ALO; p < C2S_PHASE_FLUSH; p++)
+                bytes[B_ALO + p] = t.bytes[p + 1] - t.bytes[p];
+            bytes[B_EMIT] = t.bytes[C2S_PHASE_DONE];
+            for (int p = C2S_PHASE_ALO; p < C2S_PHASE_FLUSH; p++)
+                clauses[B_ALO + p] = c2s_phase_clauses(g, k, b->encoding, p);
+            clauses[B_EMIT] = c2s_encoding_clauses(g, k, b->encoding);
+            c2s_graph_free(g);
+        }
+        long peak = peak_rss_kb();
+
+        for (int p = 0; p < B_PHASES; p++) {
+            double *s = samples + p * b->reps;
+            if (b->raw) {
+                for (int r = 0; r < b->reps; r++)
+                    fprintf(b->raw, "%s,%ld,%s,%d,%.9f\n", name, k, phaseNames[p], r, s[r]);
+            }
+            qsort(s, b->reps, sizeof(*s), cmp_double);
+            double median = percentile(s, b->reps, 0.5);
+            double p95 = percentile(s, b->reps, 0.95);
+            double mbs = median > 0 ? bytes[p] / 1e6 / median : 0;
+            double cps = median > 0 ? clauses[p] / median : 0;
+            fprintf(b->csv, "%s,%ld,%s,%d,%.9f,%.9f,%.1f,%.0f,%llu,%lld,%ld\n", name, k, phaseNames[p], b->reps,
+                    median, p95, mbs, cps, bytes[p], clauses[p], peak);
+            fprintf(stderr, "%-24s %5ld %-6s %10.6f %10.6f %9.1f %12.0f\n", name, k, phaseNames[p], median, p95,
+                    mbs, cps);
+        }
+    }
+    free(samples);
+}
+
+static void warm_page_cache(const char *path) {
+    char buf[1 << 16];
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+    close(fd);
+}
+
+static void reset_peak_rss(void) {
+    int fd = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    if (write(fd, "5", 1) < 0) {
+        /* older kernels: the peak then covers all earlier instances too */
+    }
+    close(fd);
+}
+
+static long peak_rss_kb(void) {
+    long kb = -1;
+    char buf[256];
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status != NULL) {
+        while (kb < 0 && fgets(buf, sizeof(buf), status) != NULL)
+            sscanf(buf, "VmHWM: %ld", &kb);
+        fclose(status);
+    }
+    return kb;
+}
+
+static char *write_gnm(int n, long m, unsigned long long seed) {
+    const char *dir = getenv("TMPDIR");
+    char *path = NULL;
+    if (asprintf(&path, "%s/c2s_bench_XXXXXX", dir ? dir : "/tmp") < 0) {
+        ERROR_EXIT("Out of memory\n%s", "");
+    }
+    int fd = mkstemp(path);
+    FILE *f = fd < 0 ? NULL : fdopen(fd, "w");
+    if (f == NULL) {
+        ERROR_EXIT("Error creating %s\n", path);
+    }
+    fprintf(f, "c G(n,m) random graph, seed %llu\np edge %d %ld\n", seed, n, m);
+    unsigned long long x = seed;
+    for (long e = 0; e < m; e++) {
+        unsigned long long u, v;
+        do {
+            /* splitmix64 */
+            unsigned long long z = (x += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            z ^= z >> 31;
+            u = (z >> 32) % n;
+            v = (z & 0xffffffffULL) % n;
+        } while (u == v);
+        fprintf(f, "e %llu %llu\n", u + 1, v + 1);
+    }
+    if (fclose(f) != 0) {
+        ERROR_EXIT("Error writing %s\n", path);
+    }
+    return path;
+}
+
+static double percentile(const double *sorted, int count, double p) {
+    int rank = (int)(p * count + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > count)
+        rank = count;
+    return sorted[rank - 1];
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,630 @@
+/**
+ * @file c2s_emit.c
+ * @author Michael Helm
+ * @brief DIMACS CNF text emitter for the k-colorability encoding.
+ * @date 2026-10-16
+ *
+ * Blocks 1 and 2 have the same clause structure for every vertex; only the variable offset (v-1)*k changes.
+ * While all variables base+1 .. base+k of a vertex have the same number of digits, the text of the next
+ * vertex is the text of this one with k added to every number, and no number changes its width.
+ * So the block is rendered once per digit-width class and then replayed: k is added to the ASCII digits
+ * in place (a decimal odometer) and the buffer is copied out. Vertices whose variables straddle a power
+ * of ten are formatted directly.
+ */
+#include "c2s_emit.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest literal "<var> " and longest binary clause "-<var> -<var> 0\n" */
+#define MAX_LIT_LEN 21
+#define MAX_CLAUSE2_LEN 46
+
+/* Largest AMO template kept in memory; bigger blocks are formatted directly */
+#define MAX_TEMPLATE_SIZE ((size_t)64 << 20)
+
+/* Number of AMO lines patched before they are copied out, keeps the replay in cache */
+#define REPLAY_CHUNK_LINES 2048
+
+/* Largest single reservation for the conflict clauses of one edge */
+#define EDGE_RESERVE_LIMIT 4096
+
+/* Bytes an AsciiNum copy may write behind the number itself */
+#define NUM_SLACK 24
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+/* X-macro list of the k values with their own compiled emission kernel */
+#define SPECIALIZED_K(X) \
+    X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16)
+
+/**
+ * Digits of k, least significant first, for adding k to ASCII numbers.
+ */
+typedef struct {
+    unsigned char digit[20];
+    int len;
+} Addend;
+
+/**
+ * Decimal counter kept as ASCII: the digits are digit[start .. NUM_END-1], the bytes behind them are padding
+ * so a fixed-size copy of NUM_SLACK bytes never reads past the array.
+ */
+#define NUM_END 32
+typedef struct {
+    char digit[NUM_END + NUM_SLACK];
+    int start;
+} AsciiNum;
+
+/**
+ * Write the decimal representation of x.
+ * @param p Destination, needs room for 20 characters.
+ * @param x The number.
+ * @return Pointer behind the last digit.
+ */
+static inline char *put_uint(char *p, unsigned long long x);
+
+/**
+ * @return Number of decimal digits of x.
+ */
+static int dec_width(unsigned long long x);
+
+/**
+ * Common digit width of the variables base+1 .. base+k of one vertex.
+ * @return The width, or 0 if the variables do not all have the same width.
+ */
+static int block_width(unsigned long long base, long k);
+
+/**
+ * Split k into its decimal digits.
+ */
+static void make_addend(Addend *add, long k);
+
+/**
+ * Add k to the ASCII number ending at last. The caller guarantees that the width does not change.
+ */
+static inline void add_ascii(char *last, const Addend *k);
+
+/**
+ * Render "<base+1> <base+2> ... <base+k> 0\n".
+ * @return Pointer behind the rendered text.
+ */
+static char *render_alo(char *p, unsigned long long base, long k);
+
+/**
+ * Render one "-<base+i> -<base+j> 0\n" line.
+ * @return Pointer behind the rendered text.
+ */
+static inline char *render_amo(char *p, unsigned long long base, long i, long j);
+
+/**
+ * Add k to the ASCII number ending at last, using the digits in add unless k is a compile-time constant.
+ */
+static ALWAYS_INLINE void add_k(char *last, const Addend *add, long k);
+
+/**
+ * Set an ASCII counter to x.
+ */
+static inline void num_set(AsciiNum *num, unsigned long long x);
+
+/**
+ * Count an ASCII counter up by one.
+ */
+static ALWAYS_INLINE void num_inc(AsciiNum *num);
+
+/**
+ * Write "-<a> -<b> 0\n" and count both numbers up by one.
+ * Copies NUM_SLACK bytes per number, so the destination needs that much room behind the clause.
+ * @return Pointer behind the clause.
+ */
+static ALWAYS_INLINE char *put_conflict(char *p, AsciiNum *a, AsciiNum *b);
+
+/**
+ * Block emitters. They are instantiated with a constant k for every k in SPECIALIZED_K and once
+ * with a runtime k for everything else.
+ */
+static ALWAYS_INLINE void alo_block(C2sWriter *out, long long n, long k);
+static ALWAYS_INLINE void amo_block(C2sWriter *out, long long n, long k);
+static ALWAYS_INLINE void edge_block(C2sWriter *out, long long m, const void *edges, int wide, long k);
+
+/**
+ * Emitters of the optional blocks of the encoding variants, formatted directly.
+ */
+static void seq_amo_block(C2sWriter *out, long long n, long k);
+static void symmetry_block(C2sWriter *out, long long n, long k);
+
+/**
+ * Write "<a> <b> 0\n" for signed literals.
+ */
+static inline void put_clause2(C2sWriter *out, long long a, long long b);
+
+/**
+ * @return Total number of decimal digits of 1, 2, ..., x.
+ */
+static unsigned long long digits_upto(unsigned long long x);
+
+/**
+ * @return Total number of decimal digits of the variables base+1 .. base+count.
+ */
+static unsigned long long range_digits(unsigned long long base, long count);
+
+/**
+ * @return Total number of decimal digits of first, first+step, ..., first+(count-1)*step; first and step
+ * are positive.
+ */
+static unsigned long long progression_digits(unsigned long long first, unsigned long long step,
+                                             unsigned long long count);
+
+/* 1. Every vertex is assigned at least one color:
+For each vertex v ∈ V, the following clause must be satisfied:
+(x_v,1 ∨ x_v,2 ∨ ... ∨ x_v,k) */
+static ALWAYS_INLINE void alo_block(C2sWriter *out, long long n, long k) {
+    Addend add;
+    char *tmpl = malloc((size_t)k * MAX_LIT_LEN + 2);
+    size_t tmplLen = 0;
+    int tmplWidth = 0;
+
+    make_addend(&add, k);
+
+    for (long long v = 1; v <= n; v++) {
+        unsigned long long base = (unsigned long long)(v - 1) * k;
+        int w = tmpl ? block_width(base, k) : 0;
+
+        if (w == 0) {
+            for (long i = 1; i <= k; i++) {
+                char *p = c2s_writer_reserve(out, MAX_LIT_LEN);
+                p = put_uint(p, base + i);
+                *p++ = ' ';
+                out->pos = p;
+            }
+            char *p = c2s_writer_reserve(out, 2);
+            *p++ = '0';
+            *p++ = '\n';
+            out->pos = p;
+            tmplWidth = 0;
+            continue;
+        }
+
+        if (w != tmplWidth) {
+            tmplLen = render_alo(tmpl, base, k) - tmpl;
+            tmplWidth = w;
+        } else {
+            char *last = tmpl + w - 1;
+            for (long q = 0; q < k; q++, last += w + 1)
+                add_k(last, &add, k);
+        }
+        c2s_writer_write(out, tmpl, tmplLen);
+    }
+    free(tmpl);
+}
+
+/* 2. Every vertex is assigned at most one color:
+For each vertex v ∈ V and for every possible pair of colors {c_i, c_j},
+the following clause must be satisfied:
+¬x_v,ci ∨ ¬x_v,cj */
+static ALWAYS_INLINE void amo_block(C2sWriter *out, long long n, long k) {
+    if (k < 2)
+        return;
+
+    Addend add;
+    unsigned long long pairs = (unsigned long long)k * (k - 1) / 2;
+    unsigned long long maxWidth = dec_width((unsigned long long)n * k);
+    char *tmpl = NULL;
+    if (pairs * (2 * maxWidth + 6) <= MAX_TEMPLATE_SIZE)
+        tmpl = malloc(pairs * (2 * maxWidth + 6));
+    int tmplWidth = 0;
+
+    make_addend(&add, k);
+
+    for (long long v = 1; v <= n; v++) {
+        unsigned long long base = (unsigned long long)(v - 1) * k;
+        int w = tmpl ? block_width(base, k) : 0;
+
+        if (w == 0) {
+            for (long i = 1; i <= k; i++) {
+                for (long j = i + 1; j <= k; j++) {
+                    char *p = c2s_writer_reserve(out, MAX_CLAUSE2_LEN);
+                    out->pos = render_amo(p, base, i, j);
+                }
+            }
+            tmplWidth = 0;
+            continue;
+        }
+
+        size_t lineLen = 2 * w + 6;
+        if (w != tmplWidth) {
+            char *p = tmpl;
+            for (long i = 1; i <= k; i++) {
+                for (long j = i + 1; j <= k; j++)
+                    p = render_amo(p, base, i, j);
+            }
+            c2s_writer_write(out, tmpl, p - tmpl);
+            tmplWidth = w;
+            continue;
+        }
+
+        /* replay: "-" digits " -" digits " 0\n", last digits at w and 2w+2 */
+        for (unsigned long long first = 0; first < pairs; first += REPLAY_CHUNK_LINES) {
+            unsigned long long last = first + REPLAY_CHUNK_LINES < pairs ? first + REPLAY_CHUNK_LINES : pairs;
+            char *chunk = tmpl + first * lineLen;
+            for (char *line = chunk; line < tmpl + last * lineLen; line += lineLen) {
+                add_k(line + w, &add, k);
+                add_k(line + 2 * w + 2, &add, k);
+            }
+            c2s_writer_write(out, chunk, (last - first) * lineLen);
+        }
+    }
+    free(tmpl);
+}
+
+/* 3. Every adjacent vertices have different colors:
+For each edge {u, w} ∈ E and for each possible color c,
+the following clause must be satisfied:
+¬x_u,c ∨ ¬x_w,c
+The variables of consecutive colors are consecutive, so both numbers are formatted once per edge
+and then counted up in ASCII. The edges are int pairs, or long long pairs if wide; wide is a constant at
+every call site, so the test folds away. */
+static ALWAYS_INLINE void edge_block(C2sWriter *out, long long m, const void *edges, int wide, long k) {
+    /* small k: one reservation per edge instead of one per clause */
+    int perEdge = k * MAX_CLAUSE2_LEN + NUM_SLACK <= EDGE_RESERVE_LIMIT;
+    const int (*narrow)[2] = (const int (*)[2])edges;
+    const long long (*wideEdges)[2] = (const long long (*)[2])edges;
+    AsciiNum a, b;
+
+    for (long long e = 0; e < m; e++) {
+        unsigned long long u = wide ? wideEdges[e][0] : narrow[e][0];
+        unsigned long long v = wide ? wideEdges[e][1] : narrow[e][1];
+        num_set(&a, (u - 1) * k + 1);
+        num_set(&b, (v - 1) * k + 1);
+        if (perEdge) {
+            char *p = c2s_writer_reserve(out, k * MAX_CLAUSE2_LEN + NUM_SLACK);
+            for (long i = 0; i < k; i++)
+                p = put_conflict(p, &a, &b);
+            out->pos = p;
+        } else {
+            for (long i = 0; i < k; i++) {
+                char *p = c2s_writer_reserve(out, MAX_CLAUSE2_LEN + NUM_SLACK);
+                out->pos = put_conflict(p, &a, &b);
+            }
+        }
+    }
+}
+
+/* Report the start of a block to the observer, if there is one */
+#define PHASE(p)                                          \
+    do {                                                  \
+        if (phase)                                        \
+            phase(user, (p), c2s_writer_bytes(out));      \
+    } while (0)
+
+/* Emission kernels with k fixed at compile time: the k-multiplications fold into shifts and adds,
+the ASCII carry of add_k uses constant digits and the per-edge loop has a constant trip count.
+The variant blocks are rare and stay out of the kernels. */
+#define DEFINE_KERNEL(K)                                                                                  \
+    static void emit_vertices_##K(C2sWriter *out, long long n, int encoding, C2sPhaseFn phase,          \
+                                  void *user) {                                                       \
+        alo_block(out, n, K);                                                                             \
+        PHASE(C2S_PHASE_AMO);                                                                             \
+        if (encoding & C2S_ENC_SEQ_AMO)                                                                   \
+            seq_amo_block(out, n, K);                                                                     \
+        else if (!(encoding & C2S_ENC_NO_AMO))                                                            \
+            amo_block(out, n, K);                                                                         \
+    }                                                                                                     \
+    static void emit_edges_##K(C2sWriter *out, int m, int (*edges)[2]) {                                  \
+        edge_block(out, m, edges, 0, K);                                                                  \
+    }
+#define VERTICES_CASE(K)                                        \
+    case K:                                                     \
+        emit_vertices_##K(out, n, encoding, phase, user);       \
+        break;
+#define EDGES_CASE(K)                                           \
+    case K:                                                     \
+        emit_edges_##K(out, m, edges);                          \
+        break;
+
+SPECIALIZED_K(DEFINE_KERNEL)
+
+void c2s_emit_dimacs(C2sWriter *out, long long n, long long m, int (*edges)[2], long k, int encoding,
+                     C2sPhaseFn phase, void *user) {
+    PHASE(C2S_PHASE_ALO);
+    char header[C2S_HEADER_SIZE];
+    c2s_writer_write(out, header, c2s_emit_header(header, n, m, k, encoding));
+    c2s_emit_vertices(out, n, k, encoding, phase, user);
+    PHASE(C2S_PHASE_EDGES);
+    c2s_emit_edges(out, (int)m, edges, k);
+    c2s_emit_tail(out, n, k, encoding);
+}
+
+void c2s_emit_vertices(C2sWriter *out, long long n, long k, int encoding, C2sPhaseFn phase, void *user) {
+    switch (k) {
+    SPECIALIZED_K(VERTICES_CASE)
+    default:
+        alo_block(out, n, k);
+        PHASE(C2S_PHASE_AMO);
+        if (encoding & C2S_ENC_SEQ_AMO)
+            seq_amo_block(out, n, k);
+        else if (!(encoding & C2S_ENC_NO_AMO))
+            amo_block(out, n, k);
+    }
+}
+
+void c2s_emit_edges(C2sWriter *out, int m, int (*edges)[2], long k) {
+    switch (k) {
+    SPECIALIZED_K(EDGES_CASE)
+    default:
+        edge_block(out, m, edges, 0, k);
+    }
+}
+
+void c2s_emit_edges_wide(C2sWriter *out, int m, long long (*edges)[2], long k) {
+    /* only graphs beyond INT_MAX vertices get here, the generic kernel serves them all */
+    edge_block(out, m, edges, 1, k);
+}
+
+void c2s_emit_tail(C2sWriter *out, long long n, long k, int encoding) {
+    if (encoding & C2S_ENC_SYMMETRY)
+        symmetry_block(out, n, k);
+}
+
+/* The size follows the line formats of the blocks: a literal is its digits plus a '-' if negated, every clause
+adds one ' ' per literal and "0\n". Digits of consecutive variables are summed per power of ten, so only
+the edge block costs a pass over the edges. */
+void c2s_emit_size(long long n, long long m, int (*edges)[2], long k, int encoding, long long bytes[3]) {
+    unsigned long long edgeDigits = 0;
+    for (long long e = 0; e < m; e++)
+        edgeDigits += c2s_emit_edge_digits(edges[e][0], edges[e][1], k);
+    c2s_emit_size_digits(n, m, edgeDigits, k, encoding, bytes);
+}
+
+unsigned long long c2s_emit_edge_digits(unsigned long long u, unsigned long long v, long k) {
+    return range_digits((u - 1) * k, k) + range_digits((v - 1) * k, k);
+}
+
+void c2s_emit_size_digits(long long n, long long m, unsigned long long edgeDigits, long k, int encoding,
+                          long long bytes[3]) {
+    char header[C2S_HEADER_SIZE];
+    unsigned long long nk = (unsigned long long)n * k;
+    unsigned long long allDigits = digits_upto(nk);
+
+    /* "x_1 x_2 ... x_k 0\n" */
+    bytes[0] = c2s_emit_header(header, n, m, k, encoding) + allDigits + nk + 2ULL * n;
+
+    bytes[1] = 0;
+    if (encoding & C2S_ENC_SEQ_AMO) {
+        /* x_1 and x_k occur once, x_2 .. x_k-1 twice; s_1 and s_k-1 three times, the others four times;
+        4k-5 literals are negated */
+        if (k >= 2) {
+            unsigned long long counterDigits = digits_upto(nk + (unsigned long long)n * (k - 1)) - allDigits;
+            unsigned long long total = 2 * allDigits + 4 * counterDigits;
+            /* x_1, x_k, s_1 and s_k-1 of every vertex, each an arithmetic progression over the vertices */
+            total -= progression_digits(1, k, n) + progression_digits(k, k, n) +
+                     progression_digits(nk + 1, k - 1, n) + progression_digits(nk + k - 1, k - 1, n);
+            bytes[1] = total + (unsigned long long)n * (4 * k - 5 + 4 * (3 * k - 4));
+        }
+    } else if (!(encoding & C2S_ENC_NO_AMO)) {
+        /* "-x -y 0\n", every variable is in k-1 pairs */
+        bytes[1] = (k - 1) * allDigits + 3 * nk * (k - 1);
+    }
+
+    /* "-x -y 0\n" for every edge and color */
+    bytes[2] = edgeDigits + 6ULL * m * k;
+    if (encoding & C2S_ENC_SYMMETRY) {
+        /* "-x 0\n" for the colors v+1 .. k of vertex v */
+        for (long v = 1; v < k && v <= n; v++)
+            bytes[2] += range_digits((unsigned long long)(v - 1) * k + v, k - v) + 4ULL * (k - v);
+    }
+}
+
+/* 2b. Sequential counter instead of the pairwise clauses: s_i means one of the colors 1..i is set.
+x_1 -> s_1, and for 1 < i < k: x_i -> s_i, s_i-1 -> s_i, x_i -> -s_i-1; finally x_k -> -s_k-1.
+The counter variables of vertex v follow all color variables: n*k + (v-1)*(k-1) + i. */
+static void seq_amo_block(C2sWriter *out, long long n, long k) {
+    if (k < 2)
+        return;
+    for (long long v = 1; v <= n; v++) {
+        long long x = (long long)(v - 1) * k, s = (long long)n * k + (long long)(v - 1) * (k - 1);
+        put_clause2(out, -(x + 1), s + 1);
+        for (long i = 2; i < k; i++) {
+            put_clause2(out, -(x + i), s + i);
+            put_clause2(out, -(s + i - 1), s + i);
+            put_clause2(out, -(x + i), -(s + i - 1));
+        }
+        put_clause2(out, -(x + k), -(s + k - 1));
+    }
+}
+
+/* 4. Symmetry breaking: the colors of any coloring can be renamed in the order in which vertices 1, 2, ...
+first use them, so vertex v needs none of the colors v+1..k */
+static void symmetry_block(C2sWriter *out, long long n, long k) {
+    for (long v = 1; v < k && v <= n; v++) {
+        for (long i = v + 1; i <= k; i++) {
+            char *p = c2s_writer_reserve(out, MAX_LIT_LEN + 3);
+            *p++ = '-';
+            p = put_uint(p, (unsigned long long)(v - 1) * k + i);
+            memcpy(p, " 0\n", 3);
+            out->pos = p + 3;
+        }
+    }
+}
+
+static inline void put_clause2(C2sWriter *out, long long a, long long b) {
+    char *p = c2s_writer_reserve(out, MAX_CLAUSE2_LEN);
+    if (a < 0)
+        *p++ = '-';
+    p = put_uint(p, (unsigned long long)(a < 0 ? -a : a));
+    *p++ = ' ';
+    if (b < 0)
+        *p++ = '-';
+    p = put_uint(p, (unsigned long long)(b < 0 ? -b : b));
+    memcpy(p, " 0\n", 3);
+    out->pos = p + 3;
+}
+
+int c2s_emit_header(char *buf, long long n, long long m, long k, int encoding) {
+    // Precompute CNF variable and clause count
+    C2sGraph shape = { .n = n, .m = m };
+    long long num_vars = c2s_encoding_vars(&shape, k, encoding);
+    long long num_clauses = c2s_encoding_clauses(&shape, k, encoding);
+
+    int len = snprintf(buf, C2S_HEADER_SIZE, "c CNF: %ld-coloring of %lld vertices, %lld edges\n", k, n, m);
+    if (encoding != C2S_ENC_DIRECT)
+        len += snprintf(buf + len, C2S_HEADER_SIZE - len, "c encoding: %s\n", c2s_encoding_name(encoding));
+    len += snprintf(buf + len, C2S_HEADER_SIZE - len, "p cnf %lld %lld\n", num_vars, num_clauses);
+    return len;
+}
+
+static unsigned long long digits_upto(unsigned long long x) {
+    unsigned long long total = 0, low = 1;
+    for (int w = 1; low <= x; w++, low *= 10) {
+        unsigned long long high = low <= x / 10 ? low * 10 - 1 : x;
+        total += (high - low + 1) * w;
+        if (high == x)
+            break;
+    }
+    return total;
+}
+
+static unsigned long long range_digits(unsigned long long base, long count) {
+    int w = dec_width(base + 1);
+    if (w == dec_width(base + count))
+        return (unsigned long long)count * w;
+    return digits_upto(base + count) - digits_upto(base);
+}
+
+static inline char *put_uint(char *p, unsigned long long x) {
+    char tmp[20];
+    int len = 0;
+    do {
+        tmp[len++] = (char)('0' + x % 10);
+        x /= 10;
+    } while (x);
+    while (len)
+        *p++ = tmp[--len];
+    return p;
+}
+
+static unsigned long long progression_digits(unsigned long long first, unsigned long long step,
+                                             unsigned long long count) {
+    /* a number has as many digits as there are powers of ten up to it: count the terms >= 10^j for every j */
+    unsigned long long total = count;
+    for (unsigned long long p = 10;; p *= 10) {
+        unsigned long long below = p <= first ? 0 : (p - first + step - 1) / step;
+        if (below >= count)
+            break;
+        total += count - below;
+        if (p > ULLONG_MAX / 10)
+            break;
+    }
+    return total;
+}
+
+static int dec_width(unsigned long long x) {
+    int w = 1;
+    while (x >= 10) {
+        x /= 10;
+        w++;
+    }
+    return w;
+}
+
+static int block_width(unsigned long long base, long k) {
+    int w = dec_width(base + 1);
+    return w == dec_width(base + k) ? w : 0;
+}
+
+static void make_addend(Addend *add, long k) {
+    add->len = 0;
+    for (; k; k /= 10)
+        add->digit[add->len++] = (unsigned char)(k % 10);
+}
+
+static inline void add_ascii(char *last, const Addend *k) {
+    unsigned carry = 0;
+    int i = 0;
+    for (; i < k->len; i++) {
+        unsigned s = (unsigned)(last[-i] - '0') + k->digit[i] + carry;
+        carry = s >= 10;
+        last[-i] = (char)('0' + s - (carry ? 10 : 0));
+    }
+    for (; carry; i++) {
+        if (last[-i] == '9') {
+            last[-i] = '0';
+        } else {
+            last[-i]++;
+            carry = 0;
+        }
+    }
+}
+
+static ALWAYS_INLINE void add_k(char *last, const Addend *add, long k) {
+    if (!__builtin_constant_p(k)) {
+        add_ascii(last, add);
+        return;
+    }
+    unsigned carry = 0;
+    for (; k || carry; k /= 10, last--) {
+        unsigned s = (unsigned)(*last - '0') + (unsigned)(k % 10) + carry;
+        carry = s >= 10;
+        *last = (char)('0' + s - (carry ? 10 : 0));
+    }
+}
+
+static inline void num_set(AsciiNum *num, unsigned long long x) {
+    int i = NUM_END;
+    do {
+        num->digit[--i] = (char)('0' + x % 10);
+        x /= 10;
+    } while (x);
+    num->start = i;
+}
+
+static ALWAYS_INLINE void num_inc(AsciiNum *num) {
+    int i = NUM_END - 1;
+    while (i >= num->start && num->digit[i] == '9')
+        num->digit[i--] = '0';
+    if (i < num->start) {
+        num->digit[i] = '1';
+        num->start = i;
+    } else {
+        num->digit[i]++;
+    }
+}
+
+static ALWAYS_INLINE char *put_conflict(char *p, AsciiNum *a, AsciiNum *b) {
+    *p++ = '-';
+    memcpy(p, a->digit + a->start, NUM_SLACK);
+    p += NUM_END - a->start;
+    *p++ = ' ';
+    *p++ = '-';
+    memcpy(p, b->digit + b->start, NUM_SLACK);
+    p += NUM_END - b->start;
+    memcpy(p, " 0\n", 3);
+    p += 3;
+    num_inc(a);
+    num_inc(b);
+    return p;
+}
+
+static char *render_alo(char *p, unsigned long long base, long k) {
+    for (long i = 1; i <= k; i++) {
+        p = put_uint(p, base + i);
+        *p++ = ' ';
+    }
+    *p++ = '0';
+    *p++ = '\n';
+    return p;
+}
+
+static inline char *render_amo(char *p, unsigned long long base, long i, long j) {
+    *p++ = '-';
+    p = put_uint(p, base + i);
+    *p++ = ' ';
+    *p++ = '-';
+    p = put_uint(p, base + j);
+    *p++ = ' ';
+    *p++ = '0';
+    *p++ = '\n';
+    return p;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file c2s_emit.h
+ * @author Michael Helm
+ * @brief DIMACS CNF text emitter for the k-colorability encoding.
+ * @date 2026-10-16
+ *
+ */
+#ifndef C2S_EMIT_H
+#define C2S_EMIT_H
+
+#include "libcolor2sat.h"
+
+/* Room for the comment lines and the problem line */
+#define C2S_HEADER_SIZE 160
+
+/**
+ * Emit the k-colorability CNF (comment, problem line and all three clause blocks) in DIMACS format.
+ * The per-vertex blocks 1 and 2 are produced by template replay, see c2s_emit.c.
+ * @param out Writer receiving the text.
+ * @param n Number of vertices.
+ * @param m Number of edges, at most INT_MAX like in a C2sGraph.
+ * @param edges Edge list of size m, vertices numbered from 1.
+ * @param k Number of colors.
+ * @param encoding Encoding variant, see C2S_ENC_*.
+ * @param phase Called at the start of each clause block, may be NULL.
+ * @param user Passed to phase.
+ */
+void c2s_emit_dimacs(C2sWriter *out, long long n, long long m, int (*edges)[2], long k, int encoding,
+                     C2sPhaseFn phase, void *user);
+
+/**
+ * Render the comment lines and the problem line of c2s_emit_dimacs().
+ * @param buf Destination of at least C2S_HEADER_SIZE bytes.
+ * @return Length of the header.
+ */
+int c2s_emit_header(char *buf, long long n, long long m, long k, int encoding);
+
+/**
+ * The parts of c2s_emit_dimacs() after the header, for callers that produce the edges in batches:
+ * c2s_emit_vertices() writes blocks 1 and 2, which need only n, and reports C2S_PHASE_AMO between them;
+ * c2s_emit_edges() writes the conflict clauses of a batch of edges, c2s_emit_edges_wide() those of a batch
+ * with 64-bit vertex numbers; c2s_emit_tail() writes what follows the last edge.
+ */
+void c2s_emit_vertices(C2sWriter *out, long long n, long k, int encoding, C2sPhaseFn phase, void *user);
+void c2s_emit_edges(C2sWriter *out, int m, int (*edges)[2], long k);
+void c2s_emit_edges_wide(C2sWriter *out, int m, long long (*edges)[2], long k);
+void c2s_emit_tail(C2sWriter *out, long long n, long k, int encoding);
+
+/**
+ * Size of the text c2s_emit_dimacs() produces, computed from the digit counts of the variables without
+ * formatting anything.
+ * @param bytes Receives the bytes of the phases C2S_PHASE_ALO (with the header), C2S_PHASE_AMO and
+ * C2S_PHASE_EDGES (with the symmetry breaking units).
+ */
+void c2s_emit_size(long long n, long long m, int (*edges)[2], long k, int encoding, long long bytes[3]);
+
+/**
+ * Digits of the 2k variables in the conflict clauses of edge {u, v}, the only part of the size that depends
+ * on the edges; summed over a stream of edges for c2s_emit_size_digits().
+ */
+unsigned long long c2s_emit_edge_digits(unsigned long long u, unsigned long long v, long k);
+
+/**
+ * c2s_emit_size() of m edges whose c2s_emit_edge_digits() sum to edgeDigits.
+ */
+void c2s_emit_size_digits(long long n, long long m, unsigned long long edgeDigits, long k, int encoding,
+                          long long bytes[3]);
+
+#endif /* C2S_EMIT_H */
@@ -0,0 +1,733 @@
+/**
+ * @file c2s_encode.c
+ * @author Michael Helm
+ * @brief Clause generation for libcolor2sat: callback, IPASIR and DIMACS sinks.
+ * @date 2026-10-16
+ *
+ */
+#include "libcolor2sat.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "c2s_emit.h"
+#include "c2s_extsort.h"
+#include "c2s_reader.h"
+#include "c2s_ring.h"
+
+/* Edges parsed and emitted at a time by c2s_encode_dimacs_stream() and c2s_encode_dimacs_sorted() */
+#define STREAM_BATCH 4096
+
+/* Batches the reader thread of c2s_encode_dimacs_pipelined() may run ahead, 32 MiB of edges */
+#define PIPELINE_SLOTS 1024
+
+/* Resolved only if an IPASIR solver is linked into the program */
+extern void ipasir_add(void *solver, int lit_or_zero) __attribute__((weak));
+
+/**
+ * Clause callback forwarding to ipasir_add().
+ */
+static int ipasir_sink(void *solver, const int *lits, int len);
+
+/**
+ * @return Number of symmetry breaking units: k-v for every vertex v < k, or -1 if it overflows.
+ */
+static long long symmetry_units(const C2sGraph *g, long k);
+
+/**
+ * Checked arithmetic on counts.
+ * @return a*b or a+b, or -1 if an operand is negative (an overflowed count) or the result does not fit.
+ */
+static long long mul_count(long long a, long long b);
+static long long add_count(long long a, long long b);
+
+/**
+ * @return Number of color pairs k*(k-1)/2, or -1.
+ */
+static long long color_pairs(long k);
+
+/**
+ * Write the conflict clauses of a batch of edges in the layout of the reader.
+ */
+static void emit_batch(C2sWriter *out, void *edges, int count, int wide, long k);
+
+/**
+ * Turn edges in the layout of a reader into the sort keys min(u,v) << 32 | max(u,v) of
+ * c2s_encode_dimacs_sorted(), and back.
+ */
+static void edges_to_keys(const void *edges, int count, int wide, unsigned long long *keys);
+static void keys_to_edges(const unsigned long long *keys, int count, int wide, void *edges);
+
+/**
+ * Body of both single-pass encoders.
+ * @param pipelined Parse on a reader thread that hands batches over through a C2sEdgeRing.
+ */
+static int encode_stream(const char *file, long k, int encoding, long long maxVars, int fd, C2sIoMode mode,
+                         C2sPhaseFn fn, void *user, C2sGraph *shape, long long *line, int pipelined);
+
+/**
+ * Reader thread of c2s_encode_dimacs_pipelined(): parse batches of edges into the ring until the input ends.
+ */
+static void *reader_main(void *arg);
+
+/**
+ * Arguments of reader_main().
+ */
+typedef struct {
+    C2sEdgeReader *reader;
+    C2sEdgeRing *ring;
+} ReaderJob;
+
+/**
+ * Offset at which the output starts if fd is a regular file that can be written at an offset.
+ * @return The offset, or -1 if the header could not be patched later.
+ */
+static off_t patch_offset(int fd);
+
+/**
+ * Rewrite the header of a single-pass CNF for the edge count actually read. The new header is never longer,
+ * its first comment line is padded with spaces to the old length.
+ * @return C2S_OK or C2S_ERR_IO.
+ */
+static int patch_header(int fd, off_t offset, int oldLen, long long n, long long m, long k, int encoding);
+
+/**
+ * Push a binary clause to fn.
+ * @return C2S_OK or C2S_ERR_ABORTED.
+ */
+static int clause2(C2sClauseFn fn, void *user, int a, int b);
+
+long long c2s_num_vars(const C2sGraph *g, long k) {
+    return mul_count(g->n, k);
+}
+
+long long c2s_num_clauses(const C2sGraph *g, long k) {
+    long long num_clauses = 0;
+    num_clauses = add_count(num_clauses, g->n);                            // at least one color per vertex
+    num_clauses = add_count(num_clauses, mul_count(g->n, color_pairs(k)));  // at most one color per vertex
+    num_clauses = add_count(num_clauses, mul_count(g->m, k));               // adjacent vertices differ in color
+    return num_clauses;
+}
+
+long long c2s_encoding_vars(const C2sGraph *g, long k, int encoding) {
+    long long vars = c2s_num_vars(g, k);
+    if (encoding & C2S_ENC_SEQ_AMO)
+        vars = add_count(vars, mul_count(g->n, k - 1));  // counter bits s_1 .. s_k-1 per vertex
+    return vars;
+}
+
+long long c2s_encoding_clauses(const C2sGraph *g, long k, int encoding) {
+    long long clauses = c2s_phase_clauses(g, k, encoding, C2S_PHASE_ALO);
+    clauses = add_count(clauses, c2s_phase_clauses(g, k, encoding, C2S_PHASE_AMO));
+    return add_count(clauses, c2s_phase_clauses(g, k, encoding, C2S_PHASE_EDGES));
+}
+
+long long c2s_phase_clauses(const C2sGraph *g, long k, int encoding, int phase) {
+    switch (phase) {
+    case C2S_PHASE_ALO:
+        return g->n;
+    case C2S_PHASE_AMO:
+        if (encoding & C2S_ENC_NO_AMO)
+            return 0;
+        if (encoding & C2S_ENC_SEQ_AMO)
+            return k >= 2 ? mul_count(g->n, add_count(mul_count(3, k - 2), 2)) : 0;
+        return mul_count(g->n, color_pairs(k));
+    case C2S_PHASE_EDGES:
+        return add_count(mul_count(g->m, k), encoding & C2S_ENC_SYMMETRY ? symmetry_units(g, k) : 0);
+    default:
+        return 0;
+    }
+}
+
+int c2s_encoding_check(const C2sGraph *g, long k, int encoding, long long maxVars) {
+    if (k <= 0 || !c2s_encoding_name(encoding) || g->n < 0 || g->m < 0)
+        return C2S_ERR_ARG;
+    long long vars = c2s_encoding_vars(g, k, encoding);
+    long long clauses = c2s_encoding_clauses(g, k, encoding);
+    if (vars < 0 || clauses < 0)
+        return C2S_ERR_OVERFLOW;
+
+    /* the at-least-one clauses have k literals, all others at most two; a literal takes '-', its digits and
+    a space, a clause ends with "0\n" */
+    int width = 1;
+    for (long long x = vars; x >= 10; x /= 10)
+        width++;
+    long long lits = add_count(mul_count(g->n, k), mul_count(2, clauses));
+    long long bytes = add_count(mul_count(lits, width + 2), mul_count(2, clauses));
+    if (add_count(bytes, C2S_HEADER_SIZE) < 0)
+        return C2S_ERR_OVERFLOW;
+    return maxVars > 0 && vars > maxVars ? C2S_ERR_LIMIT : C2S_OK;
+}
+
+long long c2s_encoding_bytes(const C2sGraph *g, long k, int encoding, long long *phaseBytes) {
+    long long bytes[3];
+    if (c2s_encoding_check(g, k, encoding, 0) != C2S_OK)
+        return -1;
+    c2s_emit_size(g->n, g->m, g->edges, k, encoding, bytes);
+    if (phaseBytes)
+        memcpy(phaseBytes, bytes, sizeof(bytes));
+    return bytes[0] + bytes[1] + bytes[2];
+}
+
+int c2s_encoding_bytes_stream(const char *file, long k, long long bytes[C2S_ENC_COUNT], C2sGraph *shape,
+                              long long *line) {
+    C2sEdgeReader r = { 0 };
+    void *batch = NULL;
+    unsigned long long edgeDigits = 0;
+    int got, rc = C2S_OK;
+
+    for (int encoding = 0; encoding < C2S_ENC_COUNT; encoding++)
+        bytes[encoding] = -1;
+    if (k <= 0) {
+        rc = C2S_ERR_ARG;
+        goto done;
+    }
+    rc = c2s_reader_open(&r, file);
+    if (rc != C2S_OK)
+        goto done;
+    batch = malloc(STREAM_BATCH * C2S_EDGE_SIZE(r.wide));
+    if (!batch) {
+        rc = C2S_ERR_NOMEM;
+        goto done;
+    }
+    while ((got = c2s_reader_next(&r, batch, STREAM_BATCH)) > 0) {
+        if (r.wide) {
+            long long (*edges)[2] = batch;
+            for (int e = 0; e < got; e++)
+                edgeDigits += c2s_emit_edge_digits(edges[e][0], edges[e][1], k);
+        } else {
+            int (*edges)[2] = batch;
+            for (int e = 0; e < got; e++)
+                edgeDigits += c2s_emit_edge_digits(edges[e][0], edges[e][1], k);
+        }
+    }
+    if (got < 0) {
+        rc = -got;
+        goto done;
+    }
+
+    /* sized like the output of c2s_encode_dimacs_stream(), whose header has the edges actually read */
+    C2sGraph read = { .n = r.n, .m = r.count };
+    for (int encoding = 0; encoding < C2S_ENC_COUNT; encoding++) {
+        long long phaseBytes[3];
+        if (!c2s_encoding_name(encoding) || c2s_encoding_check(&read, k, encoding, 0) != C2S_OK)
+            continue;
+        c2s_emit_size_digits(r.n, r.count, edgeDigits, k, encoding, phaseBytes);
+        bytes[encoding] = phaseBytes[0] + phaseBytes[1] + phaseBytes[2];
+    }
+
+done:
+    if (shape) {
+        shape->n = r.n;
+        shape->m = r.count;
+        shape->declaredM = r.m;
+        shape->edges = NULL;
+        shape->ignoredLines = r.ignored;
+    }
+    if (line)
+        *line = r.line;
+    c2s_reader_close(&r);
+    free(batch);
+    return rc;
+}
+
+const char *c2s_encoding_name(int encoding) {
+    static const char *const names[C2S_ENC_COUNT] = { "direct", "no-amo", "seq-amo", NULL,
+                                                      "direct+sym", "no-amo+sym", "seq-amo+sym", NULL };
+    return encoding >= 0 && encoding < C2S_ENC_COUNT ? names[encoding] : NULL;
+}
+
+int c2s_encoding_parse(const char *name) {
+    for (int encoding = 0; encoding < C2S_ENC_COUNT; encoding++) {
+        const char *known = c2s_encoding_name(encoding);
+        if (known && strcmp(known, name) == 0)
+            return encoding;
+    }
+    return -1;
+}
+
+int c2s_encode(const C2sGraph *g, int k, C2sClauseFn fn, void *user) {
+    return c2s_encode_variant(g, k, C2S_ENC_DIRECT, fn, user);
+}
+
+int c2s_encode_variant(const C2sGraph *g, int k, int encoding, C2sClauseFn fn, void *user) {
+    /* the literals are ints */
+    if (c2s_encoding_check(g, k, encoding, INT_MAX) != C2S_OK)
+        return C2S_ERR_ARG;
+
+    int *lits = malloc((size_t)k * sizeof(*lits));
+    if (!lits)
+        return C2S_ERR_NOMEM;
+    int rc = C2S_OK;
+
+    /* 1. Every vertex is assigned at least one color */
+    for (int v = 1; v <= g->n && rc == C2S_OK; v++) {
+        for (int i = 1; i <= k; i++)
+            lits[i - 1] = (v - 1) * k + i;
+        if (fn(user, lits, k))
+            rc = C2S_ERR_ABORTED;
+    }
+
+    /* 2. Every vertex is assigned at most one color */
+    if (encoding & C2S_ENC_SEQ_AMO) {
+        /* s_i: one of the colors 1..i is set; x_i -> s_i, s_i-1 -> s_i, x_i -> -s_i-1 */
+        for (int v = 1; v <= g->n && rc == C2S_OK && k >= 2; v++) {
+            int x = (v - 1) * k, s = g->n * k + (v - 1) * (k - 1);
+            rc = clause2(fn, user, -(x + 1), s + 1);
+            for (int i = 2; i < k && rc == C2S_OK; i++) {
+                rc = clause2(fn, user, -(x + i), s + i);
+                if (rc == C2S_OK)
+                    rc = clause2(fn, user, -(s + i - 1), s + i);
+                if (rc == C2S_OK)
+                    rc = clause2(fn, user, -(x + i), -(s + i - 1));
+            }
+            if (rc == C2S_OK)
+                rc = clause2(fn, user, -(x + k), -(s + k - 1));
+        }
+    }
+    for (int v = 1; v <= g->n && rc == C2S_OK && !(encoding & (C2S_ENC_NO_AMO | C2S_ENC_SEQ_AMO)); v++) {
+        for (int i = 1; i <= k && rc == C2S_OK; i++) {
+            for (int j = i + 1; j <= k; j++) {
+                int clause[2] = { -((v - 1) * k + i), -((v - 1) * k + j) };
+                if (fn(user, clause, 2)) {
+                    rc = C2S_ERR_ABORTED;
+                    break;
+                }
+            }
+        }
+    }
+
+    /* 3. Every adjacent vertices have different colors */
+    for (int e = 0; e < g->m && rc == C2S_OK; e++) {
+        int u = g->edges[e][0];
+        int v = g->edges[e][1];
+        for (int i = 1; i <= k; i++) {
+            int clause[2] = { -((u - 1) * k + i), -((v - 1) * k + i) };
+            if (fn(user, clause, 2)) {
+                rc = C2S_ERR_ABORTED;
+                break;
+            }
+        }
+    }
+
+    /* 4. Symmetry breaking: the colors can be renamed in the order of their first vertex */
+    if (encoding & C2S_ENC_SYMMETRY) {
+        for (int v = 1; v < k && v <= g->n && rc == C2S_OK; v++) {
+            for (int i = v + 1; i <= k; i++) {
+                lits[0] = -((v - 1) * k + i);
+                if (fn(user, lits, 1)) {
+                    rc = C2S_ERR_ABORTED;
+                    break;
+                }
+            }
+        }
+    }
+
+    free(lits);
+    return rc;
+}
+
+int c2s_encode_ipasir(const C2sGraph *g, int k, void *solver) {
+    if (!ipasir_add)
+        return C2S_ERR_NOSOLVER;
+    return c2s_encode(g, k, ipasir_sink, solver);
+}
+
+int c2s_encode_dimacs(const C2sGraph *g, long k, int fd, C2sIoMode mode) {
+    return c2s_encode_dimacs_observed(g, k, C2S_ENC_DIRECT, fd, mode, NULL, NULL);
+}
+
+int c2s_encode_dimacs_observed(const C2sGraph *g, long k, int encoding, int fd, C2sIoMode mode, C2sPhaseFn fn,
+                               void *user) {
+    int rc = c2s_encoding_check(g, k, encoding, 0);
+    if (rc != C2S_OK)
+        return rc;
+    C2sWriter *out = c2s_writer_open(fd, mode);
+    if (!out)
+        return errno == ENOMEM ? C2S_ERR_NOMEM : C2S_ERR_IO;
+    c2s_emit_dimacs(out, g->n, g->m, g->edges, k, encoding, fn, user);
+    unsigned long long bytes = c2s_writer_bytes(out);
+    if (fn)
+        fn(user, C2S_PHASE_FLUSH, bytes);
+    rc = c2s_writer_close(out) < 0 ? C2S_ERR_IO : C2S_OK;
+    if (fn)
+        fn(user, C2S_PHASE_DONE, bytes);
+    return rc;
+}
+
+int c2s_encode_dimacs_stream(const char *file, long k, int encoding, long long maxVars, int fd, C2sIoMode mode,
+                             C2sPhaseFn fn, void *user, C2sGraph *shape, long long *line) {
+    return encode_stream(file, k, encoding, maxVars, fd, mode, fn, user, shape, line, 0);
+}
+
+int c2s_encode_dimacs_pipelined(const char *file, long k, int encoding, long long maxVars, int fd, C2sIoMode mode,
+                                C2sPhaseFn fn, void *user, C2sGraph *shape, long long *line) {
+    return encode_stream(file, k, encoding, maxVars, fd, mode, fn, user, shape, line, 1);
+}
+
+int c2s_encode_dimacs_sorted(const char *file, long k, int encoding, long long maxVars, int fd, C2sIoMode mode,
+                             C2sPhaseFn fn, void *user, C2sGraph *shape, long long *line, C2sSortOptions *sort) {
+    C2sEdgeReader r = { 0 };
+    C2sExtSort *sorter = NULL;
+    C2sWriter *out = NULL;
+    void *batch = NULL;
+    unsigned long long *keys = NULL;
+    long long unique = 0, emitted = 0;
+    int got, rc = C2S_OK;
+
+    if (k <= 0 || !c2s_encoding_name(encoding)) {
+        rc = C2S_ERR_ARG;
+        goto done;
+    }
+    rc = c2s_reader_open(&r, file);
+    if (rc != C2S_OK)
+        goto done;
+    /* dropping duplicates only lowers m, so the counts of the problem line bound those of the CNF */
+    C2sGraph declared = { .n = r.n, .m = r.m };
+    rc = c2s_encoding_check(&declared, k, encoding, maxVars);
+    /* a key holds two 32-bit vertex numbers */
+    if (rc == C2S_OK && r.n > UINT_MAX)
+        rc = C2S_ERR_OVERFLOW;
+    if (rc != C2S_OK)
+        goto done;
+    const char *tmpDir = sort->tmpDir ? sort->tmpDir : getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    sorter = c2s_extsort_create(sort->memBudget, tmpDir);
+    batch = malloc(STREAM_BATCH * C2S_EDGE_SIZE(r.wide));
+    keys = malloc(STREAM_BATCH * sizeof(*keys));
+    if (!sorter || !batch || !keys) {
+        rc = C2S_ERR_NOMEM;
+        goto done;
+    }
+
+    while ((got = c2s_reader_next(&r, batch, STREAM_BATCH)) > 0) {
+        edges_to_keys(batch, got, r.wide, keys);
+        rc = c2s_extsort_add(sorter, keys, got);
+        if (rc != C2S_OK)
+            goto done;
+    }
+    if (got < 0) {
+        rc = -got;
+        goto done;
+    }
+    /* a header that can be patched takes an upper bound, which spares a counting merge of all runs */
+    off_t offset = patch_offset(fd);
+    rc = c2s_extsort_finish(sorter, offset < 0, &unique);
+    if (rc != C2S_OK)
+        goto done;
+
+    out = c2s_writer_open(fd, mode);
+    if (!out) {
+        rc = errno == ENOMEM ? C2S_ERR_NOMEM : C2S_ERR_IO;
+        goto done;
+    }
+    if (fn)
+        fn(user, C2S_PHASE_ALO, c2s_writer_bytes(out));
+    char header[C2S_HEADER_SIZE];
+    int headerLen = c2s_emit_header(header, r.n, unique, k, encoding);
+    c2s_writer_write(out, header, headerLen);
+    c2s_emit_vertices(out, r.n, k, encoding, fn, user);
+    if (fn)
+        fn(user, C2S_PHASE_EDGES, c2s_writer_bytes(out));
+    while ((got = c2s_extsort_next(sorter, keys, STREAM_BATCH)) > 0) {
+        keys_to_edges(keys, got, r.wide, batch);
+        emit_batch(out, batch, got, r.wide, k);
+        emitted += got;
+    }
+    if (got < 0)
+        rc = -got;
+    if (rc == C2S_OK)
+        c2s_emit_tail(out, r.n, k, encoding);
+
+    unsigned long long bytes = c2s_writer_bytes(out);
+    if (fn)
+        fn(user, C2S_PHASE_FLUSH, bytes);
+    if (c2s_writer_close(out) < 0 && rc == C2S_OK)
+        rc = C2S_ERR_IO;
+    out = NULL;
+    if (rc == C2S_OK && emitted != unique)
+        rc = patch_header(fd, offset, headerLen, r.n, emitted, k, encoding);
+    unique = emitted;
+    if (fn)
+        fn(user, C2S_PHASE_DONE, bytes);
+
+done:
+    if (out)
+        c2s_writer_close(out);
+    if (shape) {
+        shape->n = r.n;
+        shape->m = unique;
+        shape->declaredM = r.m;
+        shape->edges = NULL;
+        shape->ignoredLines = r.ignored;
+    }
+    if (line)
+        *line = r.line;
+    sort->edgesRead = r.count;
+    sort->runs = sorter ? c2s_extsort_runs(sorter) : 0;
+    sort->mergePasses = sorter ? c2s_extsort_passes(sorter) : 0;
+    c2s_reader_close(&r);
+    c2s_extsort_free(sorter);
+    free(batch);
+    free(keys);
+    return rc;
+}
+
+const char *c2s_phase_name(int phase) {
+    static const char *const names[] = { "alo", "amo", "edges", "flush", "done" };
+    return phase >= 0 && phase <= C2S_PHASE_DONE ? names[phase] : "unknown";
+}
+
+int c2s_decode(const C2sGraph *g, long k, const int *model, long long nlits, int *colors) {
+    long long numVars = c2s_num_vars(g, k);
+    for (int v = 0; v < g->n; v++)
+        colors[v] = 0;
+    for (long long i = 0; i < nlits; i++) {
+        if (model[i] <= 0 || model[i] > numVars)
+            continue;
+        int v = (int)((model[i] - 1) / k);
+        int c = (int)((model[i] - 1) % k) + 1;
+        if (colors[v] == 0 || c < colors[v])
+            colors[v] = c;
+    }
+    for (int v = 0; v < g->n; v++)
+        if (colors[v] == 0)
+            return C2S_ERR_MODEL;
+    for (int e = 0; e < g->m; e++)
+        if (colors[g->edges[e][0] - 1] == colors[g->edges[e][1] - 1])
+            return C2S_ERR_MODEL;
+    return C2S_OK;
+}
+
+const char *c2s_strerror(int code) {
+    switch (code) {
+    case C2S_OK:
+        return "success";
+    case C2S_ERR_IO:
+        return "I/O error";
+    case C2S_ERR_NOMEM:
+        return "out of memory";
+    case C2S_ERR_FORMAT:
+        return "invalid problem line format";
+    case C2S_ERR_EDGE:
+        return "invalid edge line format or count exceeding problem size";
+    case C2S_ERR_ARG:
+        return "invalid argument";
+    case C2S_ERR_ABORTED:
+        return "aborted by clause callback";
+    case C2S_ERR_NOSOLVER:
+        return "no IPASIR solver linked";
+    case C2S_ERR_MODEL:
+        return "model is not a proper coloring";
+    case C2S_ERR_COUNT:
+        return "fewer edges than announced, and the CNF header cannot be rewritten on this output";
+    case C2S_ERR_OVERFLOW:
+        return "count exceeds the supported range";
+    case C2S_ERR_LIMIT:
+        return "too many variables for the target solver";
+    default:
+        return "unknown error";
+    }
+}
+
+static long long symmetry_units(const C2sGraph *g, long k) {
+    long long last = k - 1 < g->n ? k - 1 : g->n;  // vertices 1..last get units
+    /* last < k, so last*(last+1)/2 fits whenever last*k does */
+    long long full = mul_count(last, k);
+    return full < 0 ? -1 : full - last * (last + 1) / 2;
+}
+
+static long long mul_count(long long a, long long b) {
+    long long r;
+    return a < 0 || b < 0 || __builtin_mul_overflow(a, b, &r) ? -1 : r;
+}
+
+static long long add_count(long long a, long long b) {
+    long long r;
+    return a < 0 || b < 0 || __builtin_add_overflow(a, b, &r) ? -1 : r;
+}
+
+static long long color_pairs(long k) {
+    /* halve the even factor first, k*(k-1) may not fit although the pairs do */
+    return k % 2 == 0 ? mul_count(k / 2, k - 1) : mul_count(k, (k - 1) / 2);
+}
+
+static int encode_stream(const char *file, long k, int encoding, long long maxVars, int fd, C2sIoMode mode,
+                         C2sPhaseFn fn, void *user, C2sGraph *shape, long long *line, int pipelined) {
+    C2sEdgeReader r = { 0 };
+    C2sWriter *out = NULL;
+    void *batch = NULL;
+    C2sEdgeRing *ring = NULL;
+    pthread_t reader;
+    int rc = C2S_OK;
+
+    if (k <= 0 || !c2s_encoding_name(encoding)) {
+        rc = C2S_ERR_ARG;
+        goto done;
+    }
+    rc = c2s_reader_open(&r, file);
+    if (rc != C2S_OK)
+        goto done;
+    /* the header and blocks 1 and 2 depend only on the problem line, so its counts decide */
+    C2sGraph declared = { .n = r.n, .m = r.m };
+    rc = c2s_encoding_check(&declared, k, encoding, maxVars);
+    if (rc != C2S_OK)
+        goto done;
+    if (pipelined)
+        ring = c2s_ring_create(PIPELINE_SLOTS, STREAM_BATCH, C2S_EDGE_SIZE(r.wide));
+    else
+        batch = malloc(STREAM_BATCH * C2S_EDGE_SIZE(r.wide));
+    if (!ring && !batch) {
+        rc = C2S_ERR_NOMEM;
+        goto done;
+    }
+    off_t offset = patch_offset(fd);
+    out = c2s_writer_open(fd, mode);
+    if (!out) {
+        rc = errno == ENOMEM ? C2S_ERR_NOMEM : C2S_ERR_IO;
+        goto done;
+    }
+    /* from here on the reader thread parses the edges while blocks 1 and 2 are written */
+    ReaderJob job = { &r, ring };
+    if (ring && pthread_create(&reader, NULL, reader_main, &job) != 0) {
+        rc = C2S_ERR_NOMEM;
+        goto done;
+    }
+
+    if (fn)
+        fn(user, C2S_PHASE_ALO, c2s_writer_bytes(out));
+    char header[C2S_HEADER_SIZE];
+    int headerLen = c2s_emit_header(header, r.n, r.m, k, encoding);
+    c2s_writer_write(out, header, headerLen);
+    c2s_emit_vertices(out, r.n, k, encoding, fn, user);
+    if (fn)
+        fn(user, C2S_PHASE_EDGES, c2s_writer_bytes(out));
+    if (ring) {
+        C2sEdgeBatch *b;
+        while ((b = c2s_ring_front(ring)) != NULL) {
+            emit_batch(out, b->edges, b->count, r.wide, k);
+            c2s_ring_pop(ring);
+        }
+        pthread_join(reader, NULL);
+        rc = c2s_ring_status(ring);
+    } else {
+        int got;
+        while ((got = c2s_reader_next(&r, batch, STREAM_BATCH)) > 0)
+            emit_batch(out, batch, got, r.wide, k);
+        if (got < 0)
+            rc = -got;
+    }
+    if (rc == C2S_OK)
+        c2s_emit_tail(out, r.n, k, encoding);
+
+    unsigned long long bytes = c2s_writer_bytes(out);
+    if (fn)
+        fn(user, C2S_PHASE_FLUSH, bytes);
+    if (c2s_writer_close(out) < 0 && rc == C2S_OK)
+        rc = C2S_ERR_IO;
+    out = NULL;
+    if (rc == C2S_OK && r.count != r.m)
+        rc = offset < 0 ? C2S_ERR_COUNT : patch_header(fd, offset, headerLen, r.n, r.count, k, encoding);
+    if (fn)
+        fn(user, C2S_PHASE_DONE, bytes);
+
+done:
+    if (out)
+        c2s_writer_close(out);
+    if (shape) {
+        shape->n = r.n;
+        shape->m = r.count;
+        shape->declaredM = r.m;
+        shape->edges = NULL;
+        shape->ignoredLines = r.ignored;
+    }
+    if (line)
+        *line = r.line;
+    c2s_reader_close(&r);
+    c2s_ring_free(ring);
+    free(batch);
+    return rc;
+}
+
+static void *reader_main(void *arg) {
+    ReaderJob *job = arg;
+    for (;;) {
+        C2sEdgeBatch *b = c2s_ring_slot(job->ring);
+        if (!b)
+            return NULL;
+        int got = c2s_reader_next(job->reader, b->edges, STREAM_BATCH);
+        if (got <= 0) {
+            c2s_ring_finish(job->ring, got < 0 ? -got : C2S_OK);
+            return NULL;
+        }
+        b->count = got;
+        c2s_ring_push(job->ring);
+    }
+}
+
+static void emit_batch(C2sWriter *out, void *edges, int count, int wide, long k) {
+    if (wide)
+        c2s_emit_edges_wide(out, count, edges, k);
+    else
+        c2s_emit_edges(out, count, edges, k);
+}
+
+static void edges_to_keys(const void *edges, int count, int wide, unsigned long long *keys) {
+    const int (*narrow)[2] = (const int (*)[2])edges;
+    const long long (*wideEdges)[2] = (const long long (*)[2])edges;
+    for (int e = 0; e < count; e++) {
+        unsigned long long u = wide ? wideEdges[e][0] : narrow[e][0];
+        unsigned long long v = wide ? wideEdges[e][1] : narrow[e][1];
+        keys[e] = u < v ? u << 32 | v : v << 32 | u;
+    }
+}
+
+static void keys_to_edges(const unsigned long long *keys, int count, int wide, void *edges) {
+    int (*narrow)[2] = edges;
+    long long (*wideEdges)[2] = edges;
+    for (int e = 0; e < count; e++) {
+        if (wide) {
+            wideEdges[e][0] = keys[e] >> 32;
+            wideEdges[e][1] = keys[e] & 0xffffffff;
+        } else {
+            narrow[e][0] = (int)(keys[e] >> 32);
+            narrow[e][1] = (int)(keys[e] & 0xffffffff);
+        }
+    }
+}
+
+static off_t patch_offset(int fd) {
+    struct stat st;
+    int flags = fcntl(fd, F_GETFL);
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || flags < 0 || (flags & O_APPEND))
+        return -1;
+    return lseek(fd, 0, SEEK_CUR);
+}
+
+static int patch_header(int fd, off_t offset, int oldLen, long long n, long long m, long k, int encoding) {
+    char header[C2S_HEADER_SIZE];
+    int len = c2s_emit_header(header, n, m, k, encoding);
+    /* the numbers only shrink with m; pad the first line, which ends at the first newline */
+    int pad = oldLen - len;
+    char *eol = memchr(header, '\n', len);
+    memmove(eol + pad, eol, header + len - eol);
+    memset(eol, ' ', pad);
+    return pwrite(fd, header, oldLen, offset) == oldLen ? C2S_OK : C2S_ERR_IO;
+}
+
+static int clause2(C2sClauseFn fn, void *user, int a, int b) {
+    int clause[2] = { a, b };
+    return fn(user, clause, 2) ? C2S_ERR_ABORTED : C2S_OK;
+}
+
+static int ipasir_sink(void *solver, const int *lits, int len) {
+    for (int i = 0; i < len; i++)
+        ipasir_add(solver, lits[i]);
+    ipasir_add(solver, 0);
+    return 0;
+}
@@ -0,0 +1,466 @@
+/**
+ * @file c2s_extsort.c
+ * @author Michael Helm
+ * @brief External-memory sort of 64-bit keys with deduplication.
+ * @date 2026-10-16
+ *
+ * The budget is one block of memory. While keys are added, its first half is the run buffer and its second
+ * half the scratch of the radix sort: a least significant digit sort with 8-bit digits that skips every digit
+ * all keys share, e.g. the high bytes of small vertex numbers. All runs go to one spill file, one after the
+ * other, so there is one descriptor however many runs there are. For the merge the block is cut into one read
+ * buffer per run; a run is read in pieces of at least MERGE_MIN_KEYS keys, so the disk sees large sequential
+ * reads. More runs than fit at once are merged in passes into a second spill file first.
+ */
+#include "c2s_extsort.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libcolor2sat.h"
+
+/* Smallest read buffer of one run during a merge, in keys (512 KiB) */
+#define MERGE_MIN_KEYS ((size_t)1 << 16)
+
+/**
+ * A sorted run without repeated keys: len keys at byte offset in the spill file.
+ */
+typedef struct {
+    off_t offset;
+    long long len;
+} Run;
+
+/**
+ * Read position of one run during a merge: buf[pos .. len-1] are buffered, left more keys follow at offset.
+ */
+typedef struct {
+    off_t offset;
+    long long left;
+    unsigned long long *buf;
+    size_t cap;
+    size_t pos;
+    size_t len;
+} Cursor;
+
+struct C2sExtSort {
+    char *tmpDir;
+    unsigned long long *mem;
+    size_t memKeys;
+    /* run formation: mem[0 .. runKeys-1] collects, mem[runKeys ..] is the radix scratch */
+    size_t runKeys;
+    size_t len;
+    /* result of a sort that never spilled */
+    unsigned long long *sorted;
+    size_t sortedLen;
+    size_t sortedPos;
+    /* spilled runs */
+    int fd;
+    off_t fileEnd;
+    Run *runs;
+    int numRuns;
+    int capRuns;
+    int spilled;
+    int passes;
+    /* merge state: a binary heap of the cursors by their next key */
+    int fanIn;
+    Cursor *cursors;
+    int *heap;
+    int heapLen;
+    int haveLast;
+    unsigned long long last;
+};
+
+/**
+ * Sort keys by their 8-bit digits, least significant first.
+ * @param a The keys.
+ * @param tmp Scratch space for n keys.
+ * @return a or tmp, whichever holds the sorted keys.
+ */
+static unsigned long long *radix_sort(unsigned long long *a, unsigned long long *tmp, size_t n);
+
+/**
+ * Drop repeated keys from a sorted array.
+ * @return The number of keys left.
+ */
+static size_t dedup(unsigned long long *a, size_t n);
+
+/**
+ * Sort the run buffer and append it to the spill file as a new run.
+ * @return C2S_OK, C2S_ERR_IO or C2S_ERR_NOMEM.
+ */
+static int spill_run(C2sExtSort *s);
+
+/**
+ * Create an unlinked temporary file in the directory of the sorter.
+ * @return The descriptor, or -1.
+ */
+static int open_spill(const C2sExtSort *s);
+
+/**
+ * Merge groups of fanIn runs into one run each, in a new spill file.
+ * @return C2S_OK, C2S_ERR_IO or C2S_ERR_NOMEM.
+ */
+static int merge_pass(C2sExtSort *s);
+
+/**
+ * Start merging runs, each with a read buffer of bufKeys keys taken from the front of the memory block.
+ * @return C2S_OK or C2S_ERR_IO.
+ */
+static int merge_start(C2sExtSort *s, const Run *runs, int count, size_t bufKeys);
+
+/**
+ * Take the smallest key of the merge that differs from the one taken before.
+ * @return 1 with the key, 0 at the end of the runs, or -C2S_ERR_IO.
+ */
+static int merge_next(C2sExtSort *s, unsigned long long *key);
+
+/**
+ * Read the next piece of a run into its buffer.
+ * @return C2S_OK or C2S_ERR_IO.
+ */
+static int refill(const C2sExtSort *s, Cursor *c);
+
+/**
+ * Restore the heap order below heap[i].
+ */
+static void sift_down(C2sExtSort *s, int i);
+
+/**
+ * write(2) all bytes, retrying partial writes.
+ * @return 0 or -1.
+ */
+static int write_all(int fd, const void *buf, size_t bytes);
+
+C2sExtSort *c2s_extsort_create(size_t budget, const char *tmpDir) {
+    C2sExtSort *s = calloc(1, sizeof(*s));
+    if (!s)
+        return NULL;
+    if (budget < C2S_EXTSORT_MIN_BUDGET)
+        budget = C2S_EXTSORT_MIN_BUDGET;
+    s->memKeys = budget / sizeof(*s->mem);
+    s->runKeys = s->memKeys / 2;
+    s->fanIn = (int)(s->memKeys / MERGE_MIN_KEYS) - 1;
+    s->fd = -1;
+    s->mem = malloc(s->memKeys * sizeof(*s->mem));
+    s->tmpDir = strdup(tmpDir);
+    s->cursors = malloc(s->fanIn * sizeof(*s->cursors));
+    s->heap = malloc(s->fanIn * sizeof(*s->heap));
+    if (!s->mem || !s->tmpDir || !s->cursors || !s->heap) {
+        c2s_extsort_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+int c2s_extsort_add(C2sExtSort *s, const unsigned long long *keys, int count) {
+    while (count > 0) {
+        size_t take = s->runKeys - s->len < (size_t)count ? s->runKeys - s->len : (size_t)count;
+        memcpy(s->mem + s->len, keys, take * sizeof(*keys));
+        s->len += take;
+        keys += take;
+        count -= (int)take;
+        if (s->len == s->runKeys) {
+            int rc = spill_run(s);
+            if (rc != C2S_OK)
+                return rc;
+        }
+    }
+    return C2S_OK;
+}
+
+int c2s_extsort_finish(C2sExtSort *s, int count, long long *unique) {
+    if (s->spilled == 0) {
+        s->sorted = radix_sort(s->mem, s->mem + s->runKeys, s->len);
+        s->sortedLen = dedup(s->sorted, s->len);
+        *unique = (long long)s->sortedLen;
+        return C2S_OK;
+    }
+
+    int rc = s->len > 0 ? spill_run(s) : C2S_OK;
+    while (rc == C2S_OK && s->numRuns > s->fanIn)
+        rc = merge_pass(s);
+    if (rc != C2S_OK)
+        return rc;
+
+    size_t bufKeys = s->memKeys / s->numRuns;
+    if (!count) {
+        /* each run is free of repeats, only repeats across runs are left */
+        *unique = 0;
+        for (int i = 0; i < s->numRuns; i++)
+            *unique += s->runs[i].len;
+        return merge_start(s, s->runs, s->numRuns, bufKeys);
+    }
+    unsigned long long key;
+    long long distinct = 0;
+    int got;
+    rc = merge_start(s, s->runs, s->numRuns, bufKeys);
+    if (rc != C2S_OK)
+        return rc;
+    while ((got = merge_next(s, &key)) > 0)
+        distinct++;
+    if (got < 0)
+        return -got;
+    *unique = distinct;
+    return merge_start(s, s->runs, s->numRuns, bufKeys);
+}
+
+int c2s_extsort_next(C2sExtSort *s, unsigned long long *keys, int max) {
+    if (s->spilled == 0) {
+        size_t left = s->sortedLen - s->sortedPos;
+        int got = left < (size_t)max ? (int)left : max;
+        memcpy(keys, s->sorted + s->sortedPos, (size_t)got * sizeof(*keys));
+        s->sortedPos += got;
+        return got;
+    }
+    int got = 0;
+    while (got < max) {
+        int rc = merge_next(s, &keys[got]);
+        if (rc < 0)
+            return rc;
+        if (rc == 0)
+            break;
+        got++;
+    }
+    return got;
+}
+
+int c2s_extsort_runs(const C2sExtSort *s) {
+    return s->spilled;
+}
+
+int c2s_extsort_passes(const C2sExtSort *s) {
+    return s->passes;
+}
+
+void c2s_extsort_free(C2sExtSort *s) {
+    if (!s)
+        return;
+    if (s->fd >= 0)
+        close(s->fd);
+    free(s->mem);
+    free(s->tmpDir);
+    free(s->runs);
+    free(s->cursors);
+    free(s->heap);
+    free(s);
+}
+
+static unsigned long long *radix_sort(unsigned long long *a, unsigned long long *tmp, size_t n) {
+    size_t count[8][256];
+    memset(count, 0, sizeof(count));
+    for (size_t i = 0; i < n; i++) {
+        for (int d = 0; d < 8; d++)
+            count[d][(a[i] >> (8 * d)) & 0xff]++;
+    }
+    for (int d = 0; d < 8; d++) {
+        size_t *c = count[d];
+        if (n == 0 || c[(a[0] >> (8 * d)) & 0xff] == n)
+            continue;
+        size_t sum = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t t = c[b];
+            c[b] = sum;
+            sum += t;
+        }
+        for (size_t i = 0; i < n; i++)
+            tmp[c[(a[i] >> (8 * d)) & 0xff]++] = a[i];
+        unsigned long long *swap = a;
+        a = tmp;
+        tmp = swap;
+    }
+    return a;
+}
+
+static size_t dedup(unsigned long long *a, size_t n) {
+    if (n == 0)
+        return 0;
+    size_t out = 1;
+    for (size_t i = 1; i < n; i++) {
+        if (a[i] != a[out - 1])
+            a[out++] = a[i];
+    }
+    return out;
+}
+
+static int spill_run(C2sExtSort *s) {
+    if (s->fd < 0) {
+        s->fd = open_spill(s);
+        if (s->fd < 0)
+            return C2S_ERR_IO;
+    }
+    if (s->numRuns == s->capRuns) {
+        int cap = s->capRuns ? 2 * s->capRuns : 64;
+        Run *runs = realloc(s->runs, cap * sizeof(*runs));
+        if (!runs)
+            return C2S_ERR_NOMEM;
+        s->runs = runs;
+        s->capRuns = cap;
+    }
+
+    unsigned long long *sorted = radix_sort(s->mem, s->mem + s->runKeys, s->len);
+    size_t len = dedup(sorted, s->len);
+    if (write_all(s->fd, sorted, len * sizeof(*sorted)) < 0)
+        return C2S_ERR_IO;
+    s->runs[s->numRuns].offset = s->fileEnd;
+    s->runs[s->numRuns].len = (long long)len;
+    s->numRuns++;
+    s->spilled++;
+    s->fileEnd += (off_t)(len * sizeof(*sorted));
+    s->len = 0;
+    return C2S_OK;
+}
+
+static int open_spill(const C2sExtSort *s) {
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/c2s-runs-XXXXXX", s->tmpDir) >= (int)sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        unlink(path);
+    return fd;
+}
+
+static int merge_pass(C2sExtSort *s) {
+    int out = open_spill(s);
+    if (out < 0)
+        return C2S_ERR_IO;
+    /* fanIn read buffers and one write buffer */
+    size_t bufKeys = s->memKeys / (s->fanIn + 1);
+    unsigned long long *outBuf = s->mem + (size_t)s->fanIn * bufKeys;
+    off_t end = 0;
+    int merged = 0;
+    int rc = C2S_OK;
+
+    for (int first = 0; first < s->numRuns && rc == C2S_OK; first += s->fanIn) {
+        int count = s->numRuns - first < s->fanIn ? s->numRuns - first : s->fanIn;
+        rc = merge_start(s, s->runs + first, count, bufKeys);
+        long long len = 0;
+        size_t outLen = 0;
+        int got;
+        while (rc == C2S_OK && (got = merge_next(s, &outBuf[outLen])) != 0) {
+            if (got < 0) {
+                rc = -got;
+                break;
+            }
+            len++;
+            if (++outLen == bufKeys) {
+                rc = write_all(out, outBuf, outLen * sizeof(*outBuf)) < 0 ? C2S_ERR_IO : C2S_OK;
+                outLen = 0;
+            }
+        }
+        if (rc == C2S_OK && write_all(out, outBuf, outLen * sizeof(*outBuf)) < 0)
+            rc = C2S_ERR_IO;
+        /* the cursors hold their own offsets, so the merged runs can be overwritten */
+        s->runs[merged].offset = end;
+        s->runs[merged].len = len;
+        merged++;
+        end += (off_t)(len * sizeof(*outBuf));
+    }
+    if (rc != C2S_OK) {
+        close(out);
+        return rc;
+    }
+    close(s->fd);
+    s->fd = out;
+    s->fileEnd = end;
+    s->numRuns = merged;
+    s->passes++;
+    return C2S_OK;
+}
+
+static int merge_start(C2sExtSort *s, const Run *runs, int count, size_t bufKeys) {
+    s->heapLen = 0;
+    s->haveLast = 0;
+    for (int i = 0; i < count; i++) {
+        Cursor *c = &s->cursors[i];
+        c->offset = runs[i].offset;
+        c->left = runs[i].len;
+        c->buf = s->mem + (size_t)i * bufKeys;
+        c->cap = bufKeys;
+        if (refill(s, c) != C2S_OK)
+            return C2S_ERR_IO;
+        if (c->len > 0)
+            s->heap[s->heapLen++] = i;
+    }
+    for (int i = s->heapLen / 2 - 1; i >= 0; i--)
+        sift_down(s, i);
+    return C2S_OK;
+}
+
+static int merge_next(C2sExtSort *s, unsigned long long *key) {
+    while (s->heapLen > 0) {
+        Cursor *c = &s->cursors[s->heap[0]];
+        unsigned long long x = c->buf[c->pos++];
+        if (c->pos == c->len) {
+            if (refill(s, c) != C2S_OK)
+                return -C2S_ERR_IO;
+            if (c->len == 0)
+                s->heap[0] = s->heap[--s->heapLen];
+        }
+        sift_down(s, 0);
+        /* every run is free of repeats, so a repeat comes from another run and follows right away */
+        if (s->haveLast && x == s->last)
+            continue;
+        s->haveLast = 1;
+        s->last = x;
+        *key = x;
+        return 1;
+    }
+    return 0;
+}
+
+static int refill(const C2sExtSort *s, Cursor *c) {
+    size_t want = c->left < (long long)c->cap ? (size_t)c->left : c->cap;
+    size_t bytes = want * sizeof(*c->buf);
+    size_t done = 0;
+    while (done < bytes) {
+        ssize_t r = pread(s->fd, (char *)c->buf + done, bytes - done, c->offset + (off_t)done);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return C2S_ERR_IO;
+        done += (size_t)r;
+    }
+    c->offset += (off_t)bytes;
+    c->left -= (long long)want;
+    c->pos = 0;
+    c->len = want;
+    return C2S_OK;
+}
+
+static void sift_down(C2sExtSort *s, int i) {
+    int *h = s->heap;
+    for (;;) {
+        int least = i, l = 2 * i + 1, r = l + 1;
+        if (l < s->heapLen && s->cursors[h[l]].buf[s->cursors[h[l]].pos] <
+                                  s->cursors[h[least]].buf[s->cursors[h[least]].pos])
+            least = l;
+        if (r < s->heapLen && s->cursors[h[r]].buf[s->cursors[h[r]].pos] <
+                                  s->cursors[h[least]].buf[s->cursors[h[least]].pos])
+            least = r;
+        if (least == i)
+            return;
+        int t = h[i];
+        h[i] = h[least];
+        h[least] = t;
+        i = least;
+    }
+}
+
+static int write_all(int fd, const void *buf, size_t bytes) {
+    const char *p = buf;
+    while (bytes > 0) {
+        ssize_t w = write(fd, p, bytes);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w < 0)
+            return -1;
+        p += w;
+        bytes -= (size_t)w;
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file c2s_extsort.h
+ * @author Michael Helm
+ * @brief External-memory sort of 64-bit keys with deduplication, within a fixed memory budget.
+ * @date 2026-10-16
+ *
+ * Keys are collected in a run buffer. A full buffer is radix sorted, freed of repeated keys and appended to a
+ * spill file as one run. Reading back merges the runs and drops the keys that repeat across runs. A set that
+ * fits the budget is sorted in memory and never touches the disk.
+ */
+#ifndef C2S_EXTSORT_H
+#define C2S_EXTSORT_H
+
+#include <stddef.h>
+
+/* Smallest budget: runs of 256 Ki keys, seven of them merged at once */
+#define C2S_EXTSORT_MIN_BUDGET ((size_t)4 << 20)
+
+typedef struct C2sExtSort C2sExtSort;
+
+/**
+ * Create an empty sorter.
+ * @param budget Bytes for the run buffer and, later, the merge buffers, at least C2S_EXTSORT_MIN_BUDGET.
+ * @param tmpDir Directory of the spill files, which are unlinked right after they are created.
+ * @return The sorter, or NULL if out of memory.
+ */
+C2sExtSort *c2s_extsort_create(size_t budget, const char *tmpDir);
+
+/**
+ * Add keys. A full run buffer is sorted and spilled.
+ * @return C2S_OK, C2S_ERR_IO or C2S_ERR_NOMEM.
+ */
+int c2s_extsort_add(C2sExtSort *s, const unsigned long long *keys, int count);
+
+/**
+ * End the input: sort or spill the last run and merge the spilled runs down to as many as can be merged at
+ * once.
+ * @param count Whether to count the distinct keys of spilled runs exactly, with one more merge pass that
+ * reads all runs.
+ * @param unique Receives the number of distinct keys. Without count and once runs were spilled, an upper
+ * bound instead: the keys of all runs, each run being free of repeats.
+ * @return C2S_OK, C2S_ERR_IO or C2S_ERR_NOMEM.
+ */
+int c2s_extsort_finish(C2sExtSort *s, int count, long long *unique);
+
+/**
+ * Read the next distinct keys in ascending order, after c2s_extsort_finish().
+ * @return Number of keys stored in keys, 0 at the end, or -C2S_ERR_IO.
+ */
+int c2s_extsort_next(C2sExtSort *s, unsigned long long *keys, int max);
+
+/**
+ * @return Number of runs spilled to disk, 0 if the keys fit the budget.
+ */
+int c2s_extsort_runs(const C2sExtSort *s);
+
+/**
+ * @return Number of merge passes that wrote runs back to disk.
+ */
+int c2s_extsort_passes(const C2sExtSort *s);
+
+/**
+ * Free the sorter and close its spill files.
+ */
+void c2s_extsort_free(C2sExtSort *s);
+
+#endif /* C2S_EXTSORT_H */
@@ -0,0 +1,302 @@
+/**
+ * @file c2s_fanout.c
+ * @author Michael Helm
+ * @brief tee(2)/splice(2) fan-out of one pipe into several destinations.
+ * @date 2026-10-16
+ *
+ * The input is moved round by round into a private round pipe. tee(2) cannot resume after a partial copy,
+ * so it only ever targets an empty private stage pipe of the same capacity, where the whole round fits.
+ * The last consumer of a round gets the buffers moved instead of duplicated. Each stage then drains into
+ * its destination with non-blocking splice(2), which consumes and can therefore continue after a partial
+ * write. A slow consumer holds back the next round only once its stage and its own pipe are full.
+ */
+#define _GNU_SOURCE
+#include "c2s_fanout.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+/**
+ * One destination: its private stage pipe and the number of bytes waiting there.
+ */
+typedef struct {
+    int fd;
+    int stage[2];
+    size_t staged;
+    int fed;
+    int alive;
+} Output;
+
+struct C2sFanout {
+    pthread_t thread;
+    int in[2];
+    int round[2];
+    size_t roundBytes;
+    size_t pipeSize;
+    int eof;
+    int n;
+    int alive;
+    int err;
+    Output *out;
+};
+
+/**
+ * Thread body: refill the round pipe, feed the stages and drain them until the input ends.
+ */
+static void *fanout_main(void *arg);
+
+/**
+ * Feed the current round to every live output whose stage is empty.
+ * @return 0, or -1 with f->err set on an unexpected error.
+ */
+static int feed_stages(C2sFanout *f);
+
+/**
+ * Move as much of a stage into its destination as fits without blocking; drops a closed destination.
+ */
+static void drain_stage(C2sFanout *f, Output *o);
+
+/**
+ * Stop using a destination whose reader went away.
+ */
+static void drop_output(C2sFanout *f, Output *o);
+
+/**
+ * Create a pipe with the largest allowed capacity.
+ * @return The capacity, or 0 with errno set.
+ */
+static size_t make_pipe(int p[2], size_t size);
+
+C2sFanout *c2s_fanout_start(const int *fds, int n, int *input) {
+    C2sFanout *f = calloc(1, sizeof(*f));
+    if (f == NULL || n < 1 || (f->out = calloc(n, sizeof(Output))) == NULL) {
+        free(f);
+        errno = n < 1 ? EINVAL : ENOMEM;
+        return NULL;
+    }
+    f->in[0] = f->in[1] = f->round[0] = f->round[1] = -1;
+    for (int i = 0; i < n; i++)
+        f->out[i].stage[0] = f->out[i].stage[1] = -1;
+
+    size_t maxSize = 1 << 20;
+    FILE *limit = fopen("/proc/sys/fs/pipe-max-size", "r");
+    if (limit != NULL) {
+        unsigned long v;
+        if (fscanf(limit, "%lu", &v) == 1 && v > 0)
+            maxSize = v;
+        fclose(limit);
+    }
+    f->pipeSize = make_pipe(f->round, maxSize);
+    if (f->pipeSize == 0 || make_pipe(f->in, f->pipeSize) == 0)
+        goto fail;
+    f->n = n;
+    f->alive = n;
+    for (int i = 0; i < n; i++) {
+        Output *o = &f->out[i];
+        o->fd = fds[i];
+        o->alive = 1;
+        /* the stage has to hold a whole round, otherwise tee(2) could stop halfway */
+        if (make_pipe(o->stage, f->pipeSize) != f->pipeSize)
+            goto fail;
+        fcntl(o->fd, F_SETPIPE_SZ, (int)f->pipeSize);
+    }
+    if ((errno = pthread_create(&f->thread, NULL, fanout_main, f)) != 0)
+        goto fail;
+    *input = f->in[1];
+    return f;
+
+fail:;
+    int err = errno ? errno : EIO;
+    for (int i = 0; i < n; i++) {
+        if (f->out[i].stage[0] >= 0) {
+            close(f->out[i].stage[0]);
+            close(f->out[i].stage[1]);
+        }
+    }
+    for (int i = 0; i < 2; i++) {
+        if (f->in[i] >= 0)
+            close(f->in[i]);
+        if (f->round[i] >= 0)
+            close(f->round[i]);
+    }
+    free(f->out);
+    free(f);
+    errno = err;
+    return NULL;
+}
+
+int c2s_fanout_finish(C2sFanout *f) {
+    pthread_join(f->thread, NULL);
+    int err = f->err ? f->err : (f->alive == 0 ? EPIPE : 0);
+    for (int i = 0; i < f->n; i++) {
+        if (f->out[i].alive) {
+            close(f->out[i].stage[0]);
+            close(f->out[i].stage[1]);
+            if (close(f->out[i].fd) < 0 && err == 0)
+                err = errno;
+        }
+    }
+    if (f->in[0] >= 0)
+        close(f->in[0]);
+    close(f->round[0]);
+    close(f->round[1]);
+    free(f->out);
+    free(f);
+    errno = err;
+    return err ? -1 : 0;
+}
+
+static void *fanout_main(void *arg) {
+    C2sFanout *f = arg;
+    struct pollfd *pfd = malloc((f->n + 1) * sizeof(*pfd));
+    if (pfd == NULL) {
+        f->err = ENOMEM;
+        goto out;
+    }
+    for (;;) {
+        if (f->alive == 0) {
+            f->err = EPIPE;
+            break;
+        }
+        if (f->roundBytes == 0 && !f->eof) {
+            ssize_t r = splice(f->in[0], NULL, f->round[1], NULL, f->pipeSize,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (r == 0)
+                f->eof = 1;
+            else if (r > 0)
+                f->roundBytes = r;
+            else if (errno != EAGAIN && errno != EINTR) {
+                f->err = errno;
+                break;
+            }
+        }
+        if (f->roundBytes > 0 && feed_stages(f) < 0)
+            break;
+
+        int busy = 0;
+        for (int i = 0; i < f->n; i++) {
+            if (f->out[i].alive && f->out[i].staged > 0) {
+                drain_stage(f, &f->out[i]);
+                busy |= f->out[i].alive && f->out[i].staged > 0;
+            }
+        }
+        if (f->eof && f->roundBytes == 0 && !busy)
+            break;
+
+        /* wait for input if the round pipe is empty, and for room at every consumer with staged data */
+        int np = 0;
+        if (f->roundBytes == 0 && !f->eof)
+            pfd[np++] = (struct pollfd){ .fd = f->in[0], .events = POLLIN };
+        for (int i = 0; i < f->n; i++) {
+            if (f->out[i].alive && f->out[i].staged > 0) {
+                pfd[np++] = (struct pollfd){ .fd = f->out[i].fd, .events = POLLOUT };
+            }
+        }
+        if (np > 0 && poll(pfd, np, -1) < 0 && errno != EINTR) {
+            f->err = errno;
+            break;
+        }
+    }
+out:
+    /* nobody reads the input any more, let the writer see EPIPE instead of blocking */
+    close(f->in[0]);
+    f->in[0] = -1;
+    free(pfd);
+    return NULL;
+}
+
+static int feed_stages(C2sFanout *f) {
+    int pending = 0, last = -1;
+    for (int i = 0; i < f->n; i++) {
+        Output *o = &f->out[i];
+        if (o->alive && !o->fed) {
+            pending++;
+            last = i;
+        }
+    }
+    for (int i = 0; i < f->n && pending > 0; i++) {
+        Output *o = &f->out[i];
+        if (!o->alive || o->fed || o->staged > 0)
+            continue;
+        ssize_t r;
+        if (i == last && pending == 1) {
+            r = splice(f->round[0], NULL, o->stage[1], NULL, f->roundBytes, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        } else {
+            r = tee(f->round[0], o->stage[1], f->roundBytes, SPLICE_F_NONBLOCK);
+        }
+        if (r != (ssize_t)f->roundBytes) {
+            f->err = r < 0 ? errno : EIO;
+            return -1;
+        }
+        o->staged = f->roundBytes;
+        o->fed = 1;
+        pending--;
+        if (i == last)
+            goto done;
+    }
+    if (pending > 0)
+        return 0;
+    /* every consumer was fed by tee(2), e.g. because the last one was dropped: discard the round */
+    while (f->roundBytes > 0) {
+        char scratch[1 << 16];
+        ssize_t r = read(f->round[0], scratch, sizeof(scratch));
+        if (r <= 0) {
+            f->err = r < 0 ? errno : EIO;
+            return -1;
+        }
+        f->roundBytes -= r;
+    }
+done:
+    if (pending == 0) {
+        f->roundBytes = 0;
+        for (int i = 0; i < f->n; i++)
+            f->out[i].fed = 0;
+    }
+    return 0;
+}
+
+static void drain_stage(C2sFanout *f, Output *o) {
+    while (o->staged > 0) {
+        ssize_t r = splice(o->stage[0], NULL, o->fd, NULL, o->staged, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (r > 0) {
+            o->staged -= r;
+        } else if (r < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (r == 0 || errno != EAGAIN)
+                drop_output(f, o);
+            return;
+        }
+    }
+}
+
+static void drop_output(C2sFanout *f, Output *o) {
+    close(o->stage[0]);
+    close(o->stage[1]);
+    close(o->fd);
+    o->staged = 0;
+    o->alive = 0;
+    f->alive--;
+}
+
+static size_t make_pipe(int p[2], size_t size) {
+    if (pipe2(p, O_CLOEXEC) < 0)
+        return 0;
+    int got = fcntl(p[1], F_SETPIPE_SZ, (int)size);
+    if (got < 0)
+        got = fcntl(p[1], F_GETPIPE_SZ);
+    if (got < 0) {
+        int err = errno;
+        close(p[0]);
+        close(p[1]);
+        errno = err;
+        return 0;
+    }
+    return got;
+}
@@ -0,0 +1,34 @@
+/**
+ * @file c2s_fanout.h
+ * @author Michael Helm
+ * @brief Duplicate one output stream into several descriptors with tee(2) and splice(2).
+ * The data is never copied to user space: pipe buffers are shared between the consumers by reference.
+ * @date 2026-10-16
+ *
+ */
+#ifndef C2S_FANOUT_H
+#define C2S_FANOUT_H
+
+typedef struct C2sFanout C2sFanout;
+
+/**
+ * Start a thread that copies everything written to *input into all fds.
+ * Each consumer may run ahead of the slowest one by at most one stage pipe plus its own pipe buffer,
+ * both sized to the pipe maximum (fs.pipe-max-size, 1 MiB by default). A consumer that closes its end is
+ * dropped and the others continue. SIGPIPE should be ignored by the caller.
+ * @param fds Destination descriptors, usually pipes. They are closed by c2s_fanout_finish().
+ * @param n Number of destinations, at least 1.
+ * @param input Receives the write end of the input pipe.
+ * @return The fan-out, or NULL with errno set.
+ */
+C2sFanout *c2s_fanout_start(const int *fds, int n, int *input);
+
+/**
+ * Wait until everything written to the input has reached the destinations, then free the fan-out.
+ * The caller has to close the input descriptor first.
+ * @param f The fan-out.
+ * @return 0 if at least one destination received the whole stream, -1 with errno set otherwise.
+ */
+int c2s_fanout_finish(C2sFanout *f);
+
+#endif /* C2S_FANOUT_H */
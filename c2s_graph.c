@@ -0,0 +1,211 @@
+/**
+ * @file c2s_graph.c
+ * @author Michael Helm
+ * @brief Graph loading for libcolor2sat: DIMACS .col files, edge lists and CSR arrays.
+ * @date 2026-10-16
+ *
+ */
+#include "libcolor2sat.h"
+#include "c2s_reader.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Allocate a graph with room for m edges.
+ * @return The graph or NULL.
+ */
+static C2sGraph *alloc_graph(int n, int m);
+
+int c2s_graph_read(const char *file, C2sGraph **out, long long *line) {
+    C2sEdgeReader r;
+    C2sGraph *g = NULL;
+    int rc = c2s_reader_open(&r, file);
+    if (rc != C2S_OK) {
+        if (line)
+            *line = r.line;
+        *out = NULL;
+        return rc;
+    }
+
+    /* the edge list of a graph has int vertex numbers and an int edge count */
+    if (r.wide || r.m > INT_MAX) {
+        rc = C2S_ERR_OVERFLOW;
+        goto done;
+    }
+    g = alloc_graph((int)r.n, (int)r.m);
+    if (!g) {
+        rc = C2S_ERR_NOMEM;
+        goto done;
+    }
+
+    /* alloc_graph() leaves a spare slot, so there is room for one more call even after m edges */
+    int got;
+    do {
+        long long room = r.m + 1 - r.count;
+        got = c2s_reader_next(&r, g->edges + r.count, room > INT_MAX ? INT_MAX : (int)room);
+    } while (got > 0);
+    if (got < 0) {
+        rc = -got;
+        goto done;
+    }
+    g->m = r.count;
+    g->ignoredLines = r.ignored;
+
+done:
+    c2s_reader_close(&r);
+    if (rc != C2S_OK) {
+        if (line)
+            *line = r.line;
+        c2s_graph_free(g);
+        g = NULL;
+    }
+    *out = g;
+    return rc;
+}
+
+int c2s_reader_open(C2sEdgeReader *r, const char *file) {
+    char buf[256];
+    r->n = r->m = r->count = r->line = r->ignored = 0;
+    r->wide = 0;
+    if (strcmp(file, "-") == 0) {
+        r->fp = stdin;
+    } else {
+        r->fp = fopen(file, "r");
+        if (!r->fp)
+            return C2S_ERR_IO;
+    }
+
+    /* parse problem line */
+    int rc = C2S_OK;
+    while (fgets(buf, sizeof(buf), r->fp)) {
+        r->line++;
+        if (buf[0] == 'p') {
+            if (sscanf(buf, "p edge %lld %lld", &r->n, &r->m) != 2)
+                rc = C2S_ERR_FORMAT;
+            break;
+        }
+        r->ignored++;
+    }
+    /* sscanf() saturates numbers beyond a long long, so they end up here as LLONG_MAX */
+    if (rc == C2S_OK && (r->n <= 0 || r->m < 0 || r->n == LLONG_MAX || r->m == LLONG_MAX))
+        rc = C2S_ERR_FORMAT;
+    r->wide = r->n > INT_MAX;
+    if (rc != C2S_OK)
+        c2s_reader_close(r);
+    return rc;
+}
+
+int c2s_reader_next(C2sEdgeReader *r, void *edges, int max) {
+    char buf[256];
+    int got = 0;
+    int (*narrow)[2] = edges;
+    long long (*wide)[2] = edges;
+    while (got < max && fgets(buf, sizeof(buf), r->fp)) {
+        r->line++;
+        if (buf[0] != 'e' || r->count >= r->m)
+            return -C2S_ERR_EDGE;
+        long long u, v;
+        if (sscanf(buf, "e %lld %lld", &u, &v) != 2) {
+            r->ignored++;
+            continue;
+        }
+        if (u < 1 || u > r->n || v < 1 || v > r->n)
+            return -C2S_ERR_EDGE;
+        if (r->wide) {
+            wide[got][0] = u;
+            wide[got][1] = v;
+        } else {
+            narrow[got][0] = (int)u;
+            narrow[got][1] = (int)v;
+        }
+        got++;
+        r->count++;
+    }
+    if (got == 0 && ferror(r->fp))
+        return -C2S_ERR_IO;
+    return got;
+}
+
+void c2s_reader_close(C2sEdgeReader *r) {
+    if (r->fp && r->fp != stdin)
+        fclose(r->fp);
+    r->fp = NULL;
+}
+
+int c2s_graph_from_edges(int n, int m, const int *edges, C2sGraph **out) {
+    *out = NULL;
+    if (n <= 0 || m < 0 || (m > 0 && !edges))
+        return C2S_ERR_ARG;
+    for (long long i = 0; i < 2LL * m; i++)
+        if (edges[i] < 1 || edges[i] > n)
+            return C2S_ERR_ARG;
+
+    C2sGraph *g = alloc_graph(n, m);
+    if (!g)
+        return C2S_ERR_NOMEM;
+    if (m > 0)
+        memcpy(g->edges, edges, (size_t)m * sizeof(*g->edges));
+    *out = g;
+    return C2S_OK;
+}
+
+int c2s_graph_from_csr(int n, const int *offsets, const int *adj, C2sGraph **out) {
+    *out = NULL;
+    if (n <= 0 || !offsets || (offsets[n] > 0 && !adj) || offsets[0] != 0)
+        return C2S_ERR_ARG;
+
+    int m = 0;
+    for (int u = 0; u < n; u++) {
+        if (offsets[u + 1] < offsets[u])
+            return C2S_ERR_ARG;
+        for (int i = offsets[u]; i < offsets[u + 1]; i++) {
+            if (adj[i] < 0 || adj[i] >= n)
+                return C2S_ERR_ARG;
+            m += adj[i] > u;
+        }
+    }
+
+    C2sGraph *g = alloc_graph(n, m);
+    if (!g)
+        return C2S_ERR_NOMEM;
+    int e = 0;
+    for (int u = 0; u < n; u++) {
+        for (int i = offsets[u]; i < offsets[u + 1]; i++) {
+            if (adj[i] > u) {
+                g->edges[e][0] = u + 1;
+                g->edges[e][1] = adj[i] + 1;
+                e++;
+            }
+        }
+    }
+    *out = g;
+    return C2S_OK;
+}
+
+void c2s_graph_free(C2sGraph *g) {
+    if (!g)
+        return;
+    free(g->edges);
+    free(g);
+}
+
+static C2sGraph *alloc_graph(int n, int m) {
+    C2sGraph *g = malloc(sizeof(*g));
+    if (!g)
+        return NULL;
+    g->n = n;
+    g->m = m;
+    g->declaredM = m;
+    g->ignoredLines = 0;
+    /* one spare slot keeps malloc(0) from looking like a failure */
+    g->edges = malloc(((size_t)m + 1) * sizeof(*g->edges));
+    if (!g->edges) {
+        free(g);
+        return NULL;
+    }
+    return g;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file c2s_perf.c
+ * @author Michael Helm
+ * @brief perf_event_open(2) counter group for the --perf mode of color2sat.
+ * @date 2026-10-16
+ *
+ * The counters of one group are scheduled onto the PMU together, so the ratios between them (IPC, misses
+ * per instruction) stay meaningful even when the kernel has to multiplex. Only the calling thread is
+ * counted: the parser and the emitter run there, the writer thread only waits for I/O.
+ */
+#define _GNU_SOURCE
+#include "c2s_perf.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct C2sPerf {
+    int leader;
+    int fd[C2S_PERF_EVENTS];
+    int slot[C2S_PERF_EVENTS]; /* position of the event in a group read, -1 if not counted */
+    int nr;
+};
+
+/**
+ * perf_event_open(2) for the calling thread on any CPU; glibc has no wrapper.
+ * @param attr The event.
+ * @param group Descriptor of the group leader, or -1 to open a new group.
+ * @return The event descriptor, or -1 with errno set.
+ */
+static int perf_event_open(struct perf_event_attr *attr, int group);
+
+C2sPerf *c2s_perf_open(void) {
+    static const unsigned long long config[C2S_PERF_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    C2sPerf *p = malloc(sizeof(*p));
+    if (p == NULL)
+        return NULL;
+    p->leader = -1;
+    p->nr = 0;
+    int err = ENOENT;
+    for (int i = 0; i < C2S_PERF_EVENTS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config[i];
+        attr.disabled = p->leader < 0; /* the leader starts the whole group */
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        p->fd[i] = perf_event_open(&attr, p->leader);
+        if (p->fd[i] < 0) {
+            err = errno;
+            p->slot[i] = -1;
+            continue;
+        }
+        if (p->leader < 0)
+            p->leader = p->fd[i];
+        p->slot[i] = p->nr++;
+    }
+    if (p->leader < 0) {
+        free(p);
+        errno = err;
+        return NULL;
+    }
+    ioctl(p->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(p->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return p;
+}
+
+int c2s_perf_has(const C2sPerf *p, int event) {
+    return p->slot[event] >= 0;
+}
+
+int c2s_perf_sample(C2sPerf *p, C2sPerfSample *out) {
+    /* nr, time_enabled, time_running, then one value per event in the order of opening */
+    uint64_t buf[3 + C2S_PERF_EVENTS];
+    memset(out, 0, sizeof(*out));
+    ssize_t r = read(p->leader, buf, sizeof(buf));
+    if (r < (ssize_t)((3 + p->nr) * sizeof(uint64_t))) {
+        if (r >= 0)
+            errno = EIO;
+        return -1;
+    }
+    double scale = buf[2] > 0 ? (double)buf[1] / buf[2] : 1.0;
+    for (int i = 0; i < C2S_PERF_EVENTS; i++) {
+        if (p->slot[i] >= 0)
+            out->value[i] = (unsigned long long)(buf[3 + p->slot[i]] * scale);
+    }
+    return 0;
+}
+
+static int perf_event_open(struct perf_event_attr *attr, int group) {
+    return (int)syscall(SYS_perf_event_open, attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+}
+
+const char *c2s_perf_event_name(int event) {
+    static const char *const names[] = { "cycles", "instructions", "cache-misses", "branch-misses" };
+    return event >= 0 && event < C2S_PERF_EVENTS ? names[event] : "unknown";
+}
+
+void c2s_perf_close(C2sPerf *p) {
+    if (p == NULL)
+        return;
+    ioctl(p->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    for (int i = 0; i < C2S_PERF_EVENTS; i++) {
+        if (p->slot[i] >= 0)
+            close(p->fd[i]);
+    }
+    free(p);
+}
@@ -0,0 +1,61 @@
+/**
+ * @file c2s_perf.h
+ * @author Michael Helm
+ * @brief Hardware performance counters of the calling thread, read as one perf_event_open(2) group.
+ * @date 2026-10-16
+ *
+ */
+#ifndef C2S_PERF_H
+#define C2S_PERF_H
+
+/**
+ * Counted events.
+ */
+enum {
+    C2S_PERF_CYCLES = 0,
+    C2S_PERF_INSTRUCTIONS,
+    C2S_PERF_CACHE_MISSES,
+    C2S_PERF_BRANCH_MISSES,
+    C2S_PERF_EVENTS
+};
+
+/**
+ * Counter values since c2s_perf_open(), scaled up if the kernel multiplexed the group.
+ */
+typedef struct {
+    unsigned long long value[C2S_PERF_EVENTS];
+} C2sPerfSample;
+
+typedef struct C2sPerf C2sPerf;
+
+/**
+ * Open and start the counters for the calling thread, user space only, so perf_event_paranoid 2 suffices.
+ * Events the CPU or the hypervisor does not offer are left out, see c2s_perf_has().
+ * @return The counter group, or NULL with errno set if no event can be counted.
+ */
+C2sPerf *c2s_perf_open(void);
+
+/**
+ * @return Nonzero if event is counted.
+ */
+int c2s_perf_has(const C2sPerf *p, int event);
+
+/**
+ * Read all counters at once. Events that are not counted read as 0.
+ * @param p The counter group.
+ * @param out Receives the values.
+ * @return 0, or -1 with errno set.
+ */
+int c2s_perf_sample(C2sPerf *p, C2sPerfSample *out);
+
+/**
+ * @return A static name of a C2S_PERF_* event, e.g. "cache-misses".
+ */
+const char *c2s_perf_event_name(int event);
+
+/**
+ * Stop the counters and free the group.
+ */
+void c2s_perf_close(C2sPerf *p);
+
+#endif /* C2S_PERF_H */
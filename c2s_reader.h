@@ -0,0 +1,56 @@
+/**
+ * @file c2s_reader.h
+ * @author Michael Helm
+ * @brief Incremental reader of DIMACS .col files: the problem line first, then the edges in batches.
+ * @date 2026-10-16
+ *
+ * c2s_graph_read() collects all batches into a graph; the single-pass encoder emits every batch as soon as
+ * it is read, so it never holds more than one batch of edges.
+ */
+#ifndef C2S_READER_H
+#define C2S_READER_H
+
+#include <stdio.h>
+
+/**
+ * Reader state. n and m are the numbers of the problem line, count the edges delivered so far.
+ * line is the number of the last line read, ignored counts the lines skipped like in c2s_graph_read().
+ * wide selects the edge layout: int pairs while every vertex number fits an int, long long pairs beyond.
+ */
+typedef struct {
+    FILE *fp;
+    long long n;
+    long long m;
+    long long count;
+    long long line;
+    long long ignored;
+    int wide;
+} C2sEdgeReader;
+
+/* Bytes of one edge in the layout of a reader */
+#define C2S_EDGE_SIZE(wide) ((wide) ? 2 * sizeof(long long) : 2 * sizeof(int))
+
+/**
+ * Open a .col file ("-" for stdin) and read up to and including the problem line.
+ * @param r Reader to initialize; closed again on failure.
+ * @param file The name of the input file.
+ * @return C2S_OK, C2S_ERR_IO or C2S_ERR_FORMAT.
+ */
+int c2s_reader_open(C2sEdgeReader *r, const char *file);
+
+/**
+ * Read the next edges. More edges than the problem line announces are an error.
+ * @param r The reader.
+ * @param edges Receives up to max edges, an int (*)[2] or, if r->wide, a long long (*)[2].
+ * @param max Size of edges, at least 1.
+ * @return Number of edges read, 0 at the end of the file, or a negative error code (-C2S_ERR_EDGE,
+ * -C2S_ERR_IO) with r->line at the offending line.
+ */
+int c2s_reader_next(C2sEdgeReader *r, void *edges, int max);
+
+/**
+ * Close the input unless it is stdin.
+ */
+void c2s_reader_close(C2sEdgeReader *r);
+
+#endif /* C2S_READER_H */
@@ -0,0 +1,136 @@
+/**
+ * @file c2s_ring.c
+ * @author Michael Helm
+ * @brief Lock-free single-producer/single-consumer ring of edge batches.
+ * @date 2026-10-16
+ *
+ * head counts the batches pushed, tail the batches popped; both only grow and wrap around as unsigned
+ * numbers, slot i lives at i & mask. Each index is written by one side only and published with a release
+ * store, so the batch contents are visible to the other side once it sees the new index with an acquire
+ * load. The two indices sit on separate cache lines. A side that has to wait spins, then yields, then
+ * sleeps briefly: the reader waits on a slow disk or network, the emitter on a full ring, and neither
+ * should hold a core while it does.
+ */
+#include "c2s_ring.h"
+
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "libcolor2sat.h"
+
+#define CACHE_LINE 64
+
+/* Waiting: busy polls, then sched_yield() calls, then sleeps of SLEEP_NS */
+#define SPIN_ROUNDS 256
+#define YIELD_ROUNDS 64
+#define SLEEP_NS 20000
+
+struct C2sEdgeRing {
+    C2sEdgeBatch *slots;
+    unsigned mask;
+    size_t batchBytes;
+    int status;
+    /* written by the producer */
+    _Alignas(CACHE_LINE) atomic_uint head;
+    atomic_int finished;
+    /* written by the consumer */
+    _Alignas(CACHE_LINE) atomic_uint tail;
+};
+
+/**
+ * Wait a little longer each round.
+ * @param round Rounds waited so far, counted up.
+ */
+static void backoff(int *round);
+
+C2sEdgeRing *c2s_ring_create(int slots, int batchSize, size_t edgeSize) {
+    C2sEdgeRing *r = aligned_alloc(CACHE_LINE, sizeof(*r));
+    if (!r)
+        return NULL;
+    r->slots = calloc(slots, sizeof(*r->slots));
+    if (!r->slots) {
+        free(r);
+        return NULL;
+    }
+    r->mask = (unsigned)slots - 1;
+    r->batchBytes = (size_t)batchSize * edgeSize;
+    r->status = C2S_OK;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->finished, 0);
+    atomic_init(&r->tail, 0);
+    return r;
+}
+
+C2sEdgeBatch *c2s_ring_slot(C2sEdgeRing *r) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    int round = 0;
+    while (head - atomic_load_explicit(&r->tail, memory_order_acquire) > r->mask)
+        backoff(&round);
+
+    C2sEdgeBatch *b = &r->slots[head & r->mask];
+    if (!b->edges) {
+        b->edges = malloc(r->batchBytes);
+        if (!b->edges) {
+            c2s_ring_finish(r, C2S_ERR_NOMEM);
+            return NULL;
+        }
+    }
+    return b;
+}
+
+void c2s_ring_push(C2sEdgeRing *r) {
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+void c2s_ring_finish(C2sEdgeRing *r, int status) {
+    r->status = status;
+    atomic_store_explicit(&r->finished, 1, memory_order_release);
+}
+
+C2sEdgeBatch *c2s_ring_front(C2sEdgeRing *r) {
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    int round = 0;
+    while (tail == atomic_load_explicit(&r->head, memory_order_acquire)) {
+        /* every push happens before finish, so an empty ring after finish stays empty */
+        if (atomic_load_explicit(&r->finished, memory_order_acquire)) {
+            if (tail == atomic_load_explicit(&r->head, memory_order_acquire))
+                return NULL;
+            break;
+        }
+        backoff(&round);
+    }
+    return &r->slots[tail & r->mask];
+}
+
+void c2s_ring_pop(C2sEdgeRing *r) {
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+}
+
+int c2s_ring_status(const C2sEdgeRing *r) {
+    return r->status;
+}
+
+void c2s_ring_free(C2sEdgeRing *r) {
+    if (!r)
+        return;
+    for (unsigned i = 0; i <= r->mask; i++)
+        free(r->slots[i].edges);
+    free(r->slots);
+    free(r);
+}
+
+static void backoff(int *round) {
+    if (*round < SPIN_ROUNDS) {
+        (*round)++;
+    } else if (*round < SPIN_ROUNDS + YIELD_ROUNDS) {
+        (*round)++;
+        sched_yield();
+    } else {
+        struct timespec ts = { 0, SLEEP_NS };
+        nanosleep(&ts, NULL);
+    }
+}
@@ -0,0 +1,74 @@
+/**
+ * @file c2s_ring.h
+ * @author Michael Helm
+ * @brief Lock-free single-producer/single-consumer ring of edge batches between a reader thread and the
+ * emitter.
+ * @date 2026-10-16
+ *
+ */
+#ifndef C2S_RING_H
+#define C2S_RING_H
+
+#include <stddef.h>
+
+/**
+ * One slot of the ring: count edges in edges[0 .. count-1], in the layout of the reader that filled it.
+ */
+typedef struct {
+    void *edges;
+    int count;
+} C2sEdgeBatch;
+
+typedef struct C2sEdgeRing C2sEdgeRing;
+
+/**
+ * Create a ring. The edge storage of a slot is allocated when the producer first fills it, so a ring with
+ * many slots costs memory only for the batches actually queued at once.
+ * @param slots Number of batches the ring holds, a power of two.
+ * @param batchSize Edges per batch.
+ * @param edgeSize Bytes per edge, see C2S_EDGE_SIZE().
+ * @return The ring, or NULL if out of memory.
+ */
+C2sEdgeRing *c2s_ring_create(int slots, int batchSize, size_t edgeSize);
+
+/**
+ * Producer: wait for a free slot.
+ * @return The slot to fill, or NULL if its storage could not be allocated; the ring is then finished with
+ * C2S_ERR_NOMEM and the producer stops.
+ */
+C2sEdgeBatch *c2s_ring_slot(C2sEdgeRing *r);
+
+/**
+ * Producer: hand the slot returned by c2s_ring_slot() to the consumer.
+ */
+void c2s_ring_push(C2sEdgeRing *r);
+
+/**
+ * Producer: no more batches will follow.
+ * @param status C2S_OK, or the error that ended the input.
+ */
+void c2s_ring_finish(C2sEdgeRing *r, int status);
+
+/**
+ * Consumer: wait for the next batch.
+ * @return The batch, or NULL once the producer finished and every batch was consumed.
+ */
+C2sEdgeBatch *c2s_ring_front(C2sEdgeRing *r);
+
+/**
+ * Consumer: give the batch returned by c2s_ring_front() back to the producer.
+ */
+void c2s_ring_pop(C2sEdgeRing *r);
+
+/**
+ * Consumer: call after c2s_ring_front() returned NULL.
+ * @return The status given to c2s_ring_finish(), or C2S_ERR_NOMEM if a slot could not be allocated.
+ */
+int c2s_ring_status(const C2sEdgeRing *r);
+
+/**
+ * Free the ring and its batches. Both sides must be done with it.
+ */
+void c2s_ring_free(C2sEdgeRing *r);
+
+#endif /* C2S_RING_H */
@@ -0,0 +1,117 @@
+/**
+ * @file c2s_trace.c
+ * @author Michael Helm
+ * @brief Chrome trace event writer for the --trace option of color2sat.
+ * @date 2026-10-16
+ *
+ * combined_script.py --trace writes to the same file, so encoder, wrapper and solvers end up on one
+ * timeline. Timestamps are CLOCK_MONOTONIC microseconds, the clock of Python's time.monotonic() as well.
+ */
+#define _GNU_SOURCE
+#include "c2s_trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+struct C2sTrace {
+    char *path;
+    char *buf;
+    size_t len;
+    FILE *events;
+    long pid;
+};
+
+/**
+ * Append data to the trace file, creating it with the opening bracket if it does not exist yet. The new
+ * file is written under a temporary name and linked into place, so no other writer sees it without '['.
+ * @return 0, or -1 with errno set.
+ */
+static int append_events(const char *path, const char *data, size_t len);
+
+/**
+ * write(2) all of data.
+ * @return 0, or -1 with errno set.
+ */
+static int write_all(int fd, const char *data, size_t len);
+
+C2sTrace *c2s_trace_open(const char *path, const char *processName) {
+    C2sTrace *t = calloc(1, sizeof(*t));
+    if (t == NULL || (t->path = strdup(path)) == NULL || (t->events = open_memstream(&t->buf, &t->len)) == NULL) {
+        if (t != NULL)
+            free(t->path);
+        free(t);
+        return NULL;
+    }
+    t->pid = (long)getpid();
+    fprintf(t->events, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":\"%s\"}},\n",
+            t->pid, t->pid, processName);
+    return t;
+}
+
+void c2s_trace_span(C2sTrace *t, const char *name, double start, double end, const char *args) {
+    fprintf(t->events, "{\"name\":\"%s\",\"cat\":\"color2sat\",\"ph\":\"X\",\"pid\":%ld,\"tid\":%ld,"
+                       "\"ts\":%.3f,\"dur\":%.3f,\"args\":{%s}},\n",
+            name, t->pid, (long)syscall(SYS_gettid), start * 1e6, (end - start) * 1e6, args ? args : "");
+}
+
+int c2s_trace_close(C2sTrace *t) {
+    int rc = fclose(t->events) == 0 ? append_events(t->path, t->buf, t->len) : -1;
+    int err = errno;
+    free(t->buf);
+    free(t->path);
+    free(t);
+    errno = err;
+    return rc;
+}
+
+static int append_events(const char *path, const char *data, size_t len) {
+    char tmp[PATH_MAX];
+    if (snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid()) >= (int)sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    /* our pid owns the name, so an existing tmp is left over from a crashed run whose pid was reused */
+    if (fd < 0 && errno == EEXIST && unlink(tmp) == 0)
+        fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+    if (fd < 0)
+        return -1;
+    int rc = write_all(fd, "[\n", 2) == 0 && write_all(fd, data, len) == 0 ? 0 : -1;
+    if (close(fd) < 0)
+        rc = -1;
+    if (rc == 0)
+        rc = link(tmp, path);
+    int err = errno;
+    unlink(tmp);
+    if (rc == 0 || err != EEXIST) {
+        errno = err;
+        return rc;
+    }
+    /* the file exists: O_APPEND keeps the events of concurrent writers apart */
+    fd = open(path, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    rc = write_all(fd, data, len);
+    if (close(fd) < 0)
+        rc = -1;
+    return rc;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t w = write(fd, data, len);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            return -1;
+        data += w;
+        len -= w;
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file c2s_trace.h
+ * @author Michael Helm
+ * @brief Spans in the Chrome trace event format, appended to a file that several processes share.
+ * @date 2026-10-16
+ *
+ */
+#ifndef C2S_TRACE_H
+#define C2S_TRACE_H
+
+typedef struct C2sTrace C2sTrace;
+
+/**
+ * Start collecting events of this process. Nothing is written before c2s_trace_close().
+ * @param path The trace file, created if needed.
+ * @param processName Name of the process track in the viewer.
+ * @return The trace, or NULL with errno set.
+ */
+C2sTrace *c2s_trace_open(const char *path, const char *processName);
+
+/**
+ * Add a complete event ("ph":"X") on the calling thread.
+ * @param t The trace.
+ * @param name Name of the span.
+ * @param start Start in seconds on CLOCK_MONOTONIC, the clock all processes of a trace share.
+ * @param end End in seconds on CLOCK_MONOTONIC.
+ * @param args Members of the "args" object without braces, e.g. "\"bytes\":42", or NULL.
+ */
+void c2s_trace_span(C2sTrace *t, const char *name, double start, double end, const char *args);
+
+/**
+ * Append the collected events to the file in a single write(2) and free the trace.
+ * The file is in the JSON array format without the closing bracket, which the viewers accept, so
+ * concurrent writers only ever append. The first writer creates it with the opening bracket atomically.
+ * @return 0, or -1 with errno set.
+ */
+int c2s_trace_close(C2sTrace *t);
+
+#endif /* C2S_TRACE_H */
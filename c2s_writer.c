@@ -0,0 +1,524 @@
+/**
+ * @file c2s_writer.c
+ * @author Michael Helm
+ * @brief Buffered output writer with an io_uring backend, a pthread double-buffer fallback and plain write(2).
+ * @date 2026-10-16
+ *
+ * All backends cycle through their buffers in a fixed order, so the buffer after the one just filled is
+ * always the next one to reuse. Regular files are written with explicit offsets and may have all buffers in
+ * flight at once. Pipes, ttys and O_APPEND files have no usable offset, so only one write is in flight there
+ * and the order of the stream is preserved. Formatting still overlaps with that write.
+ */
+#include "c2s_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define BUF_SIZE C2S_WRITER_BUF_SIZE
+#define URING_BUFS 8
+#define THREAD_BUFS 2
+
+enum { BUF_FREE, BUF_FILLING, BUF_QUEUED, BUF_INFLIGHT };
+
+/**
+ * One output buffer: len bytes are valid, done of them have been written at file offset off.
+ */
+typedef struct {
+    char *base;
+    size_t len;
+    size_t done;
+    unsigned long long off;
+    int state;
+} Buffer;
+
+/**
+ * Mapped io_uring submission and completion rings.
+ */
+typedef struct {
+    int fd;
+    unsigned *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sqRing, *cqRing;
+    size_t sqRingSize, cqRingSize, sqesSize;
+    unsigned toSubmit;
+    int fixed;
+} Uring;
+
+typedef struct {
+    C2sWriter pub;
+    C2sIoMode mode;
+    int fd;
+    int err;
+    int nbufs;
+    Buffer *bufs;
+    char *mem;
+    int cur;
+    int subNext;
+    int inflight;
+    int depth;
+    int seekable;
+    unsigned long long offset;
+    unsigned long long handed;
+    Uring ring;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stop;
+} Writer;
+
+/**
+ * Write len bytes to fd, retrying on partial writes and EINTR.
+ * @return 0 on success, an errno value otherwise.
+ */
+static int write_all(int fd, const char *p, size_t len);
+
+/**
+ * Remember the first error. A broken pipe is reported with SIGPIPE like a plain write(2) would.
+ */
+static void latch_error(Writer *w, int err);
+
+/**
+ * Allocate n page-aligned buffers of BUF_SIZE bytes.
+ * @return 0 on success, -1 with errno set to ENOMEM otherwise.
+ */
+static int alloc_buffers(Writer *w, int n);
+static void free_buffers(Writer *w);
+
+static int uring_init(Writer *w);
+static void uring_destroy(Writer *w);
+static void uring_pump(Writer *w);
+static void uring_enter(Writer *w, unsigned minComplete);
+static void uring_reap(Writer *w);
+static void *thread_main(void *arg);
+
+C2sWriter *c2s_writer_open(int fd, C2sIoMode mode) {
+    Writer *w = calloc(1, sizeof(*w));
+    if (!w)
+        return NULL;
+    w->fd = fd;
+    w->ring.fd = -1;
+
+    struct stat st;
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fstat(fd, &st) < 0) {
+        free(w);
+        return NULL;
+    }
+    off_t pos = lseek(fd, 0, SEEK_CUR);
+    w->seekable = (S_ISREG(st.st_mode) || S_ISBLK(st.st_mode)) && !(flags & O_APPEND) && pos >= 0;
+    w->offset = w->seekable ? (unsigned long long)pos : 0;
+
+    w->mode = mode == C2S_IO_AUTO ? C2S_IO_URING : mode;
+    if (w->mode == C2S_IO_URING && (alloc_buffers(w, URING_BUFS) < 0 || uring_init(w) < 0)) {
+        free_buffers(w);
+        w->mode = C2S_IO_THREAD;
+    }
+    if (w->mode == C2S_IO_THREAD) {
+        if (alloc_buffers(w, THREAD_BUFS) < 0) {
+            free(w);
+            return NULL;
+        }
+        pthread_mutex_init(&w->lock, NULL);
+        pthread_cond_init(&w->cond, NULL);
+        if (pthread_create(&w->thread, NULL, thread_main, w) != 0) {
+            pthread_mutex_destroy(&w->lock);
+            pthread_cond_destroy(&w->cond);
+            free_buffers(w);
+            w->mode = C2S_IO_SYNC;
+        }
+    }
+    if (w->mode == C2S_IO_SYNC && alloc_buffers(w, 1) < 0) {
+        free(w);
+        return NULL;
+    }
+
+    w->cur = 0;
+    w->bufs[0].state = BUF_FILLING;
+    w->pub.pos = w->bufs[0].base;
+    w->pub.end = w->bufs[0].base + BUF_SIZE;
+    return &w->pub;
+}
+
+char *c2s_writer_flip(C2sWriter *pub, size_t need) {
+    Writer *w = (Writer *)pub;
+    Buffer *b = &w->bufs[w->cur];
+
+    /* a reservation larger than a buffer can never be satisfied; writing on would overrun it */
+    if (need > BUF_SIZE)
+        abort();
+
+    b->len = pub->pos - b->base;
+    b->done = 0;
+    w->handed += b->len;
+
+    if (w->mode == C2S_IO_SYNC) {
+        if (!w->err && b->len > 0) {
+            int err = write_all(w->fd, b->base, b->len);
+            if (err)
+                latch_error(w, err);
+        }
+        pub->pos = b->base;
+        pub->end = b->base + BUF_SIZE;
+        return pub->pos;
+    }
+
+    b->off = w->offset;
+    w->offset += b->len;
+    int next = (w->cur + 1) % w->nbufs;
+
+    if (w->mode == C2S_IO_THREAD) {
+        pthread_mutex_lock(&w->lock);
+        b->state = BUF_QUEUED;
+        pthread_cond_broadcast(&w->cond);
+        while (w->bufs[next].state != BUF_FREE)
+            pthread_cond_wait(&w->cond, &w->lock);
+        pthread_mutex_unlock(&w->lock);
+    } else {
+        b->state = BUF_QUEUED;
+        uring_reap(w);
+        uring_pump(w);
+        while (w->bufs[next].state != BUF_FREE) {
+            uring_enter(w, 1);
+            uring_reap(w);
+            uring_pump(w);
+        }
+        if (w->ring.toSubmit)
+            uring_enter(w, 0);
+    }
+
+    w->cur = next;
+    w->bufs[next].state = BUF_FILLING;
+    pub->pos = w->bufs[next].base;
+    pub->end = pub->pos + BUF_SIZE;
+    return pub->pos;
+}
+
+void c2s_writer_write(C2sWriter *w, const void *data, size_t len) {
+    const char *src = data;
+    while (len > 0) {
+        size_t avail = w->end - w->pos;
+        if (avail == 0) {
+            c2s_writer_flip(w, 1);
+            avail = w->end - w->pos;
+        }
+        size_t chunk = len < avail ? len : avail;
+        memcpy(w->pos, src, chunk);
+        w->pos += chunk;
+        src += chunk;
+        len -= chunk;
+    }
+}
+
+unsigned long long c2s_writer_bytes(const C2sWriter *pub) {
+    const Writer *w = (const Writer *)pub;
+    return w->handed + (unsigned long long)(pub->pos - w->bufs[w->cur].base);
+}
+
+int c2s_writer_close(C2sWriter *pub) {
+    Writer *w = (Writer *)pub;
+
+    if (w->mode == C2S_IO_SYNC) {
+        c2s_writer_flip(pub, 0);
+    } else if (w->mode == C2S_IO_THREAD) {
+        Buffer *b = &w->bufs[w->cur];
+        b->len = pub->pos - b->base;
+        b->done = 0;
+        pthread_mutex_lock(&w->lock);
+        b->state = BUF_QUEUED;
+        w->stop = 1;
+        pthread_cond_broadcast(&w->cond);
+        pthread_mutex_unlock(&w->lock);
+        pthread_join(w->thread, NULL);
+        pthread_mutex_destroy(&w->lock);
+        pthread_cond_destroy(&w->cond);
+    } else {
+        Buffer *b = &w->bufs[w->cur];
+        b->len = pub->pos - b->base;
+        b->done = 0;
+        b->off = w->offset;
+        w->offset += b->len;
+        b->state = BUF_QUEUED;
+        uring_pump(w);
+        while (w->inflight > 0 || w->bufs[w->subNext].state == BUF_QUEUED) {
+            uring_enter(w, 1);
+            uring_reap(w);
+            uring_pump(w);
+        }
+        uring_destroy(w);
+    }
+
+    /* positional writes leave the file offset untouched */
+    if (w->seekable && w->mode == C2S_IO_URING)
+        lseek(w->fd, (off_t)w->offset, SEEK_SET);
+
+    int err = w->err;
+    free_buffers(w);
+    free(w);
+    if (err) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+static int alloc_buffers(Writer *w, int n) {
+    w->nbufs = n;
+    w->bufs = calloc(n, sizeof(*w->bufs));
+    if (!w->bufs || posix_memalign((void **)&w->mem, 4096, n * BUF_SIZE) != 0) {
+        free(w->bufs);
+        w->bufs = NULL;
+        w->mem = NULL;
+        errno = ENOMEM;
+        return -1;
+    }
+    for (int i = 0; i < n; i++)
+        w->bufs[i].base = w->mem + i * BUF_SIZE;
+    return 0;
+}
+
+static void free_buffers(Writer *w) {
+    free(w->mem);
+    free(w->bufs);
+    w->mem = NULL;
+    w->bufs = NULL;
+    w->nbufs = 0;
+}
+
+static int write_all(int fd, const char *p, size_t len) {
+    while (len > 0) {
+        ssize_t r = write(fd, p, len);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        p += r;
+        len -= r;
+    }
+    return 0;
+}
+
+static void latch_error(Writer *w, int err) {
+    if (w->err)
+        return;
+    w->err = err;
+    if (err == EPIPE && w->mode == C2S_IO_URING)
+        raise(SIGPIPE);
+}
+
+/* ---------------------------------------------------------------- pthread backend */
+
+static void *thread_main(void *arg) {
+    Writer *w = arg;
+    pthread_mutex_lock(&w->lock);
+    for (;;) {
+        Buffer *b = &w->bufs[w->subNext];
+        while (b->state != BUF_QUEUED && !w->stop)
+            pthread_cond_wait(&w->cond, &w->lock);
+        if (b->state != BUF_QUEUED)
+            break;
+        b->state = BUF_INFLIGHT;
+        int failed = w->err;
+        pthread_mutex_unlock(&w->lock);
+
+        int err = failed ? 0 : write_all(w->fd, b->base, b->len);
+
+        pthread_mutex_lock(&w->lock);
+        if (err && !w->err)
+            w->err = err;
+        b->state = BUF_FREE;
+        w->subNext = (w->subNext + 1) % w->nbufs;
+        pthread_cond_broadcast(&w->cond);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+/* ---------------------------------------------------------------- io_uring backend */
+
+static int uring_init(Writer *w) {
+    Uring *r = &w->ring;
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+
+    int fd = (int)syscall(__NR_io_uring_setup, URING_BUFS, &p);
+    if (fd < 0)
+        return -1;
+    /* IORING_OP_WRITE and offset -1 need 5.6; RW_CUR_POS appeared in the same release */
+    if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+        close(fd);
+        return -1;
+    }
+    r->fd = fd;
+
+    r->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cqRingSize > r->sqRingSize)
+            r->sqRingSize = r->cqRingSize;
+        r->cqRingSize = 0;
+    }
+    r->sqRing = mmap(NULL, r->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sqRing == MAP_FAILED)
+        goto fail_fd;
+    r->cqRing = r->sqRing;
+    if (r->cqRingSize) {
+        r->cqRing = mmap(NULL, r->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (r->cqRing == MAP_FAILED)
+            goto fail_sq;
+    }
+    r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED)
+        goto fail_cq;
+
+    char *sq = r->sqRing, *cq = r->cqRing;
+    r->sqTail = (unsigned *)(sq + p.sq_off.tail);
+    r->sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sqArray = (unsigned *)(sq + p.sq_off.array);
+    r->cqHead = (unsigned *)(cq + p.cq_off.head);
+    r->cqTail = (unsigned *)(cq + p.cq_off.tail);
+    r->cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    /* registered buffers save the page pinning on every write; plain writes work without them */
+    struct iovec iov[URING_BUFS];
+    for (int i = 0; i < URING_BUFS; i++) {
+        iov[i].iov_base = w->bufs[i].base;
+        iov[i].iov_len = BUF_SIZE;
+    }
+    r->fixed = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS, iov, URING_BUFS) == 0;
+
+    w->depth = w->seekable ? URING_BUFS : 1;
+    return 0;
+
+fail_cq:
+    if (r->cqRingSize)
+        munmap(r->cqRing, r->cqRingSize);
+fail_sq:
+    munmap(r->sqRing, r->sqRingSize);
+fail_fd:
+    close(fd);
+    r->fd = -1;
+    return -1;
+}
+
+static void uring_destroy(Writer *w) {
+    Uring *r = &w->ring;
+    munmap(r->sqes, r->sqesSize);
+    if (r->cqRingSize)
+        munmap(r->cqRing, r->cqRingSize);
+    munmap(r->sqRing, r->sqRingSize);
+    close(r->fd);
+}
+
+/**
+ * Queue a write for the unwritten part of buffer i. Submitted with the next uring_enter().
+ */
+static void uring_submit(Writer *w, int i) {
+    Uring *r = &w->ring;
+    Buffer *b = &w->bufs[i];
+    unsigned tail = *r->sqTail;
+    unsigned idx = tail & *r->sqMask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = r->fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = w->fd;
+    sqe->addr = (uintptr_t)(b->base + b->done);
+    sqe->len = (unsigned)(b->len - b->done);
+    sqe->off = w->seekable ? b->off + b->done : (unsigned long long)-1;
+    sqe->buf_index = r->fixed ? i : 0;
+    sqe->user_data = i;
+    r->sqArray[idx] = idx;
+    __atomic_store_n(r->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    b->state = BUF_INFLIGHT;
+    w->inflight++;
+    r->toSubmit++;
+}
+
+/**
+ * Submit queued buffers in stream order as far as the in-flight limit allows.
+ */
+static void uring_pump(Writer *w) {
+    while (w->inflight < w->depth && w->bufs[w->subNext].state == BUF_QUEUED) {
+        Buffer *b = &w->bufs[w->subNext];
+        if (w->err || b->len == 0)
+            b->state = BUF_FREE;
+        else
+            uring_submit(w, w->subNext);
+        w->subNext = (w->subNext + 1) % w->nbufs;
+    }
+}
+
+static void uring_enter(Writer *w, unsigned minComplete) {
+    Uring *r = &w->ring;
+    unsigned flags = minComplete ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        long ret = syscall(__NR_io_uring_enter, r->fd, r->toSubmit, minComplete, flags, NULL, 0);
+        if (ret >= 0) {
+            r->toSubmit -= (unsigned)ret;
+            return;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EBUSY) {
+            /* completions must be reaped before the kernel accepts more work */
+            uring_reap(w);
+            continue;
+        }
+        /* the ring itself is unusable: give up on everything still in flight */
+        latch_error(w, errno);
+        for (int i = 0; i < w->nbufs; i++)
+            if (w->bufs[i].state == BUF_INFLIGHT || w->bufs[i].state == BUF_QUEUED)
+                w->bufs[i].state = BUF_FREE;
+        w->inflight = 0;
+        r->toSubmit = 0;
+        return;
+    }
+}
+
+static void uring_reap(Writer *w) {
+    Uring *r = &w->ring;
+    unsigned head = *r->cqHead;
+    unsigned tail = __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cqMask];
+        int i = (int)cqe->user_data;
+        int res = cqe->res;
+        Buffer *b = &w->bufs[i];
+        head++;
+        w->inflight--;
+
+        if (res == -EINTR || res == -EAGAIN) {
+            uring_submit(w, i);
+            continue;
+        }
+        if (res <= 0) {
+            latch_error(w, res < 0 ? -res : EIO);
+            b->state = BUF_FREE;
+            continue;
+        }
+        b->done += (size_t)res;
+        if (b->done < b->len && !w->err)
+            uring_submit(w, i);
+        else
+            b->state = BUF_FREE;
+    }
+    __atomic_store_n(r->cqHead, head, __ATOMIC_RELEASE);
+}
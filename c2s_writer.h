@@ -0,0 +1,85 @@
+/**
+ * @file c2s_writer.h
+ * @author Michael Helm
+ * @brief Buffered output writer for the CNF text.
+ * The caller formats directly into a buffer owned by the writer. Full buffers are handed to a backend
+ * (io_uring, a pthread writer or plain write(2)) while formatting continues in the next free buffer.
+ * @date 2026-10-16
+ *
+ */
+#ifndef C2S_WRITER_H
+#define C2S_WRITER_H
+
+#include <stddef.h>
+
+/* Size of a single buffer, i.e. the largest amount that can be reserved at once */
+#define C2S_WRITER_BUF_SIZE ((size_t)1 << 20)
+
+/**
+ * Output backends. C2S_IO_AUTO tries io_uring first and falls back to the pthread double buffer.
+ */
+typedef enum {
+    C2S_IO_AUTO = 0,
+    C2S_IO_URING,
+    C2S_IO_THREAD,
+    C2S_IO_SYNC
+} C2sIoMode;
+
+/**
+ * Public part of the writer: the unused region [pos, end) of the buffer currently being filled.
+ * Callers write at pos and advance it; everything else is private to c2s_writer.c.
+ */
+typedef struct C2sWriter {
+    char *pos;
+    char *end;
+} C2sWriter;
+
+/**
+ * Create a writer for an open file descriptor. The descriptor is not closed by the writer.
+ * @param fd Destination file descriptor (regular file, pipe, tty, ...).
+ * @param mode Requested backend. C2S_IO_URING falls back to C2S_IO_THREAD if the kernel refuses io_uring.
+ * @return Pointer to the writer, or NULL with errno set.
+ */
+C2sWriter *c2s_writer_open(int fd, C2sIoMode mode);
+
+/**
+ * Hand the current buffer to the backend and switch to the next free one.
+ * Blocks while all buffers are still in flight.
+ * @param w The writer.
+ * @param need Number of bytes the caller wants to write next. Must not exceed C2S_WRITER_BUF_SIZE.
+ * @return The new write position (w->pos).
+ */
+char *c2s_writer_flip(C2sWriter *w, size_t need);
+
+/**
+ * Make sure at least need bytes can be written at the returned position.
+ * @param w The writer.
+ * @param need Number of bytes, at most C2S_WRITER_BUF_SIZE.
+ * @return The write position (w->pos).
+ */
+static inline char *c2s_writer_reserve(C2sWriter *w, size_t need) {
+    return (size_t)(w->end - w->pos) >= need ? w->pos : c2s_writer_flip(w, need);
+}
+
+/**
+ * Copy len bytes into the output, splitting them over as many buffers as needed.
+ * @param w The writer.
+ * @param data The bytes to copy.
+ * @param len Number of bytes.
+ */
+void c2s_writer_write(C2sWriter *w, const void *data, size_t len);
+
+/**
+ * @param w The writer.
+ * @return Number of bytes written into the writer so far, including those not yet flushed.
+ */
+unsigned long long c2s_writer_bytes(const C2sWriter *w);
+
+/**
+ * Flush all buffers, wait for outstanding writes and free the writer.
+ * @param w The writer.
+ * @return 0 on success, -1 with errno set to the first write error otherwise.
+ */
+int c2s_writer_close(C2sWriter *w);
+
+#endif /* C2S_WRITER_H */
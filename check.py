@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""
+Check that the encoding modes of color2sat agree with the default path. For every graph, k and encoding,
+the CNFs of --single-pass, --pipeline and -o must have the header and the clauses of the default mode,
+compared after sorting the clauses. --external-sort must give those of the default mode on the graph with
+its edges normalized and deduplicated, once in memory and once spilling runs. The byte counts of --estimate
+and --estimate --single-pass must equal the sizes of the CNFs they estimate. The exit status is 1 if any
+check failed.
+
+    check.py                                            # graphinstances and generated graphs
+    check.py -k 4 graphinstances/le450_5a.col           # only this graph, only k = 4
+"""
+import argparse
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+ENCODINGS = ['direct', 'no-amo', 'seq-amo', 'direct+sym', 'no-amo+sym', 'seq-amo+sym']
+DEFAULT_K = '3,20'
+DEFAULT_GRAPHS = ['graphinstances/flat300_20_0.col', 'graphinstances/le450_5a.col',
+                  'graphinstances/le450_15b.col']
+# gengraph arguments; the last one also gets repeated and reversed edges
+GENERATED = [['-s', '1', 'gnm', '2000', '20000'],
+             ['-s', '2', 'leighton', '450', '15', '8000'],
+             ['-s', '3', 'geometric', '3000', '0.03'],
+             ['-s', '4', 'flat', '20000', '3', '200000']]
+# large enough for --external-sort --mem-budget 4M to spill runs
+REPEATS = 150000
+SPILL_BUDGET = '4M'
+
+
+def run(cmd):
+    """Run a command and return its stdout; raise with its stderr if it fails."""
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    if proc.returncode != 0:
+        raise RuntimeError(f"{' '.join(cmd)}: exit code {proc.returncode}: {proc.stderr.decode().strip()}")
+    return proc.stdout
+
+
+def read_edges(path):
+    """Read a .col file into (n, [(u, v), ...]) in file order."""
+    n, edges = 0, []
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if fields and fields[0] == 'p':
+                n = int(fields[2])
+            elif fields and fields[0] == 'e':
+                edges.append((int(fields[1]), int(fields[2])))
+    return n, edges
+
+
+def write_graph(path, n, edges, comment):
+    with open(path, 'w') as f:
+        f.write(f'c {comment}\np edge {n} {len(edges)}\n')
+        f.writelines(f'e {u} {v}\n' for u, v in edges)
+
+
+def add_repeats(path, out, count, seed):
+    """Write the graph of path with count of its edges repeated, half of them reversed, in shuffled order."""
+    n, edges = read_edges(path)
+    rng = random.Random(seed)
+    repeats = rng.sample(edges, min(count, len(edges)))
+    edges += [(v, u) if i % 2 else (u, v) for i, (u, v) in enumerate(repeats)]
+    rng.shuffle(edges)
+    write_graph(out, n, edges, f'{path} with {len(repeats)} repeated edges')
+
+
+def normalize(path, out):
+    """Write the graph of path with every edge as (min, max), sorted and without repeats."""
+    n, edges = read_edges(path)
+    write_graph(out, n, sorted({(min(u, v), max(u, v)) for u, v in edges}), f'{path} normalized')
+
+
+def clauses(cnf):
+    """Split a CNF into its p line and its clause lines; the comment lines before the p line are dropped."""
+    _, _, rest = (b'\n' + cnf).partition(b'\np ')
+    header, _, body = rest.partition(b'\n')
+    return header, body
+
+
+def same_clauses(ref, cnf):
+    """Whether two CNFs have the same p line and the same clauses, in any order."""
+    ref, cnf = clauses(ref), clauses(cnf)
+    return ref[0] == cnf[0] and (ref[1] == cnf[1] or sorted(ref[1].split(b'\n')) == sorted(cnf[1].split(b'\n')))
+
+
+def estimates(cnf):
+    """Parse the --estimate table into {encoding: bytes}."""
+    table = {}
+    for line in cnf.decode().splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[0] in ENCODINGS:
+            table[fields[0]] = int(fields[3])
+    return table
+
+
+class Checker:
+    def __init__(self, color2sat, tmp):
+        self.color2sat = color2sat
+        self.tmp = tmp
+        self.checks = 0
+        self.failures = []
+
+    def expect(self, ok, what):
+        self.checks += 1
+        if not ok:
+            self.failures.append(what)
+            print(f'FAIL {what}', file=sys.stderr)
+
+    def cnf(self, args, graph, k, to_file):
+        """CNF of color2sat with args, written to stdout or with -o to a regular file."""
+        cmd = [self.color2sat] + args
+        if not to_file:
+            return run(cmd + [graph, str(k)])
+        out = os.path.join(self.tmp, 'out.cnf')
+        run(cmd + ['-o', out, graph, str(k)])
+        with open(out, 'rb') as f:
+            return f.read()
+
+    def same(self, ref, cnf, what):
+        self.expect(same_clauses(ref, cnf), what)
+
+    def graph(self, graph, ks):
+        normalized = os.path.join(self.tmp, 'normalized.col')
+        normalize(graph, normalized)
+        for k in ks:
+            table = estimates(run([self.color2sat, '--estimate', graph, str(k)]))
+            table_single = estimates(run([self.color2sat, '--estimate', '--single-pass', graph, str(k)]))
+            for encoding in ENCODINGS:
+                enc = ['--encoding', encoding]
+                what = f'{graph} k={k} {encoding}'
+                ref = self.cnf(enc, graph, k, False)
+                single = self.cnf(enc + ['--single-pass'], graph, k, False)
+                self.expect(table.get(encoding) == len(ref),
+                            f'{what} --estimate: {table.get(encoding)} bytes, wc -c {len(ref)}')
+                self.expect(table_single.get(encoding) == len(single),
+                            f'{what} --estimate --single-pass: {table_single.get(encoding)} bytes, '
+                            f'wc -c {len(single)}')
+                self.same(ref, single, f'{what} --single-pass')
+                self.same(ref, self.cnf(enc, graph, k, True), f'{what} -o')
+                self.same(ref, self.cnf(enc + ['--single-pass'], graph, k, True), f'{what} --single-pass -o')
+                for to_file in (False, True):
+                    self.same(ref, self.cnf(enc + ['--pipeline'], graph, k, to_file),
+                              f'{what} --pipeline{" -o" if to_file else ""}')
+                ref = self.cnf(enc, normalized, k, False)
+                for budget in ([], ['--mem-budget', SPILL_BUDGET]):
+                    for to_file in (False, True):
+                        self.same(ref, self.cnf(enc + ['--external-sort'] + budget, graph, k, to_file),
+                                  f'{what} --external-sort {" ".join(budget)}{" -o" if to_file else ""}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('graphs', nargs='*', help='.col files (default: some graphinstances and generated graphs)')
+    parser.add_argument('-k', default=DEFAULT_K, help=f'comma separated colors (default {DEFAULT_K})')
+    parser.add_argument('--color2sat', default='./color2sat')
+    parser.add_argument('--gengraph', default='./gengraph')
+    args = parser.parse_args()
+    ks = [int(k) for k in args.k.split(',')]
+
+    with tempfile.TemporaryDirectory(prefix='c2s_check') as tmp:
+        checker = Checker(args.color2sat, tmp)
+        graphs = [(graph, ks) for graph in args.graphs]
+        if not graphs:
+            graphs = [(graph, ks) for graph in DEFAULT_GRAPHS]
+            for i, gen in enumerate(GENERATED):
+                path = os.path.join(tmp, f'{gen[2]}{i}.col')
+                run([args.gengraph, '-o', path] + gen)
+                if i == len(GENERATED) - 1:
+                    add_repeats(path, path, REPEATS, i)
+                    # a large graph, so only the smallest k
+                    graphs.append((path, ks[:1]))
+                else:
+                    graphs.append((path, ks))
+        for graph, graph_ks in graphs:
+            checker.graph(graph, graph_ks)
+        print(f'{checker.checks - len(checker.failures)} of {checker.checks} checks passed')
+        return 1 if checker.failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -2,7 +2,7 @@
  * @file color2sat.c
  * @author Michael Helm
  * @brief Reads a graph in DIMACS format and an integer k, then converts the k-coloring problem into an equivalent SAT problem in DIMACS CNF format and prints it to stdout. 
- * Outputs can be piped into a SAT solver or a file.
+ * Outputs can be piped into a SAT solver or written to a file with -o.
  * @date 2025-05-14
  * 
  */
@@ -10,6 +10,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "c2s_fanout.h"
+#include "c2s_perf.h"
+#include "c2s_trace.h"
+#include "libcolor2sat.h"
 
 char *progName = "<not set>";
 
@@ -35,15 +48,35 @@ char *progName = "<not set>";
         exit(EXIT_FAILURE);                                            \
     }
 
+/* Long options without a short form */
+enum { OPT_IO = 256, OPT_FANOUT, OPT_JSONL, OPT_STATS, OPT_PERF, OPT_TRACE, OPT_ENCODING, OPT_ESTIMATE, OPT_SINGLE_PASS, OPT_PIPELINE,
+       OPT_MAX_VARS, OPT_EXTERNAL_SORT, OPT_MEM_BUDGET, OPT_TMP_DIR };
+
+/* Default --mem-budget of --external-sort */
+#define DEFAULT_MEM_BUDGET ((size_t)1 << 30)
+
+/**
+ * Named --max-vars limits: the largest variable a solver reads from a DIMACS file.
+ */
+static const struct {
+    const char *name;
+    long long maxVars;
+} varLimits[] = {
+    { "int", INT_MAX },             /* any reader with int literals, the default */
+    { "kissat", (1LL << 30) - 1 },  /* larger problem lines fail with "maximum variable too large" */
+    { "minisat", (1LL << 30) - 1 }, /* a literal is 2*var+sign in an int */
+    { "none", 0 },                  /* 64-bit literals, only overflow is checked */
+};
+
 /**
- * Graph structure: number of vertices n, number of edges m,
- * and an edge list of size m*2.
+ * Start time, output offset and, with --perf, counter values of every encoding phase, filled in by on_phase().
  */
 typedef struct {
-    int n;
-    int m;
-    int (*edges)[2];
-} Graph;
+    double start[C2S_PHASE_DONE + 1];
+    unsigned long long bytes[C2S_PHASE_DONE + 1];
+    C2sPerf *perf;
+    C2sPerfSample counts[C2S_PHASE_DONE + 1];
+} PhaseTimes;
 
 /**
  * Print usage and exit.
@@ -51,148 +84,675 @@ typedef struct {
 static void usage(void);
 
 /**
- * Read DIMACS .col graph from File stream.
- * DIMACS Format has to match the format described here https://mat.tepper.cmu.edu/COLOR/instances.html
- * Returns allocated Graph*, or exits on failure.
- * @param file the name of the input file. <name|-> - for stdin
- * @return Pointer to the allocated Graph structure.
- * @details The caller is responsible for freeing the memory.
+ * @return Seconds on the monotonic clock.
+ */
+static double now(void);
+
+/**
+ * C2sPhaseFn recording the start time of each phase into a PhaseTimes.
+ */
+static void on_phase(void *user, int phase, unsigned long long bytes);
+
+/**
+ * Append one JSON line describing this run to a file, in a single write(2) so concurrent runs do not mix.
+ * The run id is taken from the environment variable C2S_RUN_ID (set by combined_script.py --jsonl).
+ * @param path The JSONL file, created if needed.
+ * @param graphFile The input graph.
+ * @param g The graph.
+ * @param k Number of colors.
+ * @param encoding Encoding variant.
+ * @param parse Seconds spent reading the graph.
+ * @param t Phase start times of the encoding.
+ * @param status Exit status of the run.
+ * @return 0 on success, -1 with errno set.
+ */
+static int write_jsonl(const char *path, const char *graphFile, const C2sGraph *g, long k, int encoding,
+                       double parse, const PhaseTimes *t, int status);
+
+/**
+ * Print timings and throughput of every phase to stderr as 'c' comment lines.
+ * @param g The graph.
+ * @param k Number of colors.
+ * @param encoding Encoding variant.
+ * @param parse Seconds spent reading the graph, and sorting it with --external-sort.
+ * @param t Phase start times of the encoding.
+ * @param sort Statistics of --external-sort, or NULL.
+ */
+static void print_stats(const C2sGraph *g, long k, int encoding, double parse, const PhaseTimes *t,
+                        const C2sSortOptions *sort);
+
+/**
+ * Print hardware counters, IPC and misses per edge or clause of every phase to stderr as 'c' comment lines.
+ * @param perf The counter group.
+ * @param g The graph.
+ * @param k Number of colors.
+ * @param encoding Encoding variant.
+ * @param read Counter values before and after reading the graph.
+ * @param t Counter values of the encoding phases.
+ */
+static void print_perf(const C2sPerf *perf, const C2sGraph *g, long k, int encoding, const C2sPerfSample read[2],
+                       const PhaseTimes *t);
+
+/**
+ * Print one line of print_perf().
+ * @param units Number of edges or clauses handled in the phase, 0 to leave out the per-unit figures.
+ */
+static void print_perf_line(const C2sPerf *perf, const char *label, const C2sPerfSample *from,
+                            const C2sPerfSample *to, long long units, const char *unit);
+
+/**
+ * Append the spans of reading the graph and of every encoding phase to a trace file.
+ * @param path The trace file.
+ * @param g The graph.
+ * @param k Number of colors.
+ * @param encoding Encoding variant.
+ * @param parseStart Time reading the graph began.
+ * @param parse Seconds spent reading the graph.
+ * @param t Phase start times and output offsets of the encoding.
+ * @return 0, or -1 with errno set.
  */
-static Graph *read_graph(const char *file);
+static int write_trace(const char *path, const C2sGraph *g, long k, int encoding, double parseStart, double parse,
+                       const PhaseTimes *t);
 
 /**
- * Free Graph and its resources.
- * @param g Pointer to the Graph structure to be freed.
+ * Print variables, clauses and bytes of the CNF of every encoding variant to stdout, without encoding.
+ * @param g The graph; only n and m are used.
+ * @param k Number of colors.
+ * @param parse Seconds spent reading the graph.
+ * @param bytes Bytes of the CNF of every variant, indexed by C2S_ENC_*.
  */
-static void free_graph(Graph *g);
+static void print_estimate(const C2sGraph *g, long k, double parse, const long long *bytes);
+
+/**
+ * Parse the argument of --mem-budget: a number of bytes with an optional K, M or G suffix (powers of 1024).
+ * @return The size, or 0 if arg is invalid.
+ */
+static size_t parse_size(const char *arg);
+
+/**
+ * Parse the argument of --max-vars: a name from varLimits or a positive number.
+ * @param target Receives the name, or NULL for a number.
+ * @return The limit, 0 for none, or -1 if arg is invalid.
+ */
+static long long parse_max_vars(const char *arg, const char **target);
+
+/**
+ * Report a CNF that c2s_encoding_check() rejected with its counts, and exit.
+ * @param g The graph; for a single-pass run only n and the declared edge count are known.
+ * @param k Number of colors.
+ * @param encoding Encoding variant.
+ * @param rc C2S_ERR_OVERFLOW or C2S_ERR_LIMIT.
+ * @param maxVars The limit given with --max-vars.
+ * @param target The solver named with --max-vars, or NULL for a numeric limit.
+ */
+static void reject_cnf(const C2sGraph *g, long k, int encoding, int rc, long long maxVars, const char *target);
+
+/**
+ * Count repeated edges, (u,v) and (v,u) being the same edge, and self-loops.
+ * @param g The graph.
+ * @param selfLoops Receives the number of edges (v,v).
+ * @return Number of edges that repeat an earlier one, or -1 if out of memory.
+ */
+static long count_duplicate_edges(const C2sGraph *g, long *selfLoops);
+
+/**
+ * qsort(3) comparator of unsigned long long.
+ */
+static int cmp_ull(const void *a, const void *b);
+
+/**
+ * Peak resident set size of this program. VmHWM is preferred over getrusage(2), whose ru_maxrss keeps the
+ * peak of the process image before execve(2), e.g. of a Python parent that forked us.
+ * @return The peak in KiB.
+ */
+static long peak_rss_kb(void);
+
+/**
+ * Write s as a JSON string literal.
+ */
+static void json_string(FILE *f, const char *s);
 
 int main(int argc, char *argv[]) {
     progName = argv[0];
-    if (argc != 3)
-        usage();
 
-    const char *graphFile = argv[1];
+    const char *outFile = NULL;
+    const char *jsonlFile = NULL;
+    int stats = 0;
+    int perfMode = 0;
+    const char *traceFile = NULL;
     char *endptr = NULL;
-    long k = strtol(argv[2], &endptr, 10);
+    C2sIoMode ioMode = C2S_IO_AUTO;
+    int fanout = 0;
+    int encoding = C2S_ENC_DIRECT;
+    int estimate = 0;
+    int singlePass = 0;
+    int pipeline = 0;
+    const char *target = "int";
+    long long maxVars = INT_MAX;
+    int sorted = 0;
+    C2sSortOptions sortOpts = { DEFAULT_MEM_BUDGET, NULL, 0, 0, 0 };
+    static const struct option longOpts[] = {
+        { "output", required_argument, NULL, 'o' },
+        { "io",     required_argument, NULL, OPT_IO },
+        { "fanout", required_argument, NULL, OPT_FANOUT },
+        { "jsonl",  required_argument, NULL, OPT_JSONL },
+        { "stats",  no_argument,       NULL, OPT_STATS },
+        { "perf",   no_argument,       NULL, OPT_PERF },
+        { "trace",  required_argument, NULL, OPT_TRACE },
+        { "encoding", required_argument, NULL, OPT_ENCODING },
+        { "estimate", no_argument,       NULL, OPT_ESTIMATE },
+        { "single-pass", no_argument,    NULL, OPT_SINGLE_PASS },
+        { "pipeline", no_argument,       NULL, OPT_PIPELINE },
+        { "max-vars", required_argument, NULL, OPT_MAX_VARS },
+        { "external-sort", no_argument,  NULL, OPT_EXTERNAL_SORT },
+        { "mem-budget", required_argument, NULL, OPT_MEM_BUDGET },
+        { "tmp-dir", required_argument,  NULL, OPT_TMP_DIR },
+        { NULL, 0, NULL, 0 }
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "o:", longOpts, NULL)) != -1) {
+        switch (opt) {
+        case 'o':
+            outFile = optarg;
+            break;
+        case OPT_IO:
+            if (strcmp(optarg, "auto") == 0)
+                ioMode = C2S_IO_AUTO;
+            else if (strcmp(optarg, "uring") == 0)
+                ioMode = C2S_IO_URING;
+            else if (strcmp(optarg, "thread") == 0)
+                ioMode = C2S_IO_THREAD;
+            else if (strcmp(optarg, "sync") == 0)
+                ioMode = C2S_IO_SYNC;
+            else
+                usage();
+            break;
+        case OPT_FANOUT:
+            fanout = (int)strtol(optarg, &endptr, 10);
+            if (*endptr != '\0' || fanout < 1 || fanout > 64)
+                usage();
+            break;
+        case OPT_JSONL:
+            jsonlFile = optarg;
+            break;
+        case OPT_STATS:
+            stats = 1;
+            break;
+        case OPT_PERF:
+            perfMode = 1;
+            break;
+        case OPT_TRACE:
+            traceFile = optarg;
+            break;
+        case OPT_ENCODING:
+            encoding = c2s_encoding_parse(optarg);
+            if (encoding < 0)
+                usage();
+            break;
+        case OPT_ESTIMATE:
+            estimate = 1;
+            break;
+        case OPT_SINGLE_PASS:
+            singlePass = 1;
+            break;
+        case OPT_PIPELINE:
+            /* a single pass with the parsing on a reader thread */
+            singlePass = 1;
+            pipeline = 1;
+            break;
+        case OPT_MAX_VARS:
+            maxVars = parse_max_vars(optarg, &target);
+            if (maxVars < 0)
+                usage();
+            break;
+        case OPT_EXTERNAL_SORT:
+            /* a single pass whose edges go through the sorter before the emitter */
+            singlePass = 1;
+            sorted = 1;
+            break;
+        case OPT_MEM_BUDGET:
+            sortOpts.memBudget = parse_size(optarg);
+            if (sortOpts.memBudget < ((size_t)4 << 20))
+                usage();
+            break;
+        case OPT_TMP_DIR:
+            sortOpts.tmpDir = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (argc - optind != 2 || (outFile && fanout) || (estimate && (outFile || fanout || pipeline || sorted)) ||
+        (sorted && pipeline))
+        usage();
+
+    const char *graphFile = argv[optind];
+    long k = strtol(argv[optind + 1], &endptr, 10);
     if (*endptr != '\0' || k <= 0) {
         ERROR_EXIT("Invalid k: must be positive integer in base 10.\n%s", "");
     }
 
-    Graph *g = read_graph(graphFile);
-    int n = g->n;
-    int m = g->m;
-    int (*edges)[2] = g->edges;
-
-    // Precompute CNF clause count
-    int num_vars = n * k;
-    long long num_clauses = 0;
-    num_clauses += n;                               // at least one color per vertex
-    num_clauses += (long long)n * k * (k - 1) / 2;  // at most one color per vertex
-    num_clauses += (long long)m * k;                // adjacent vertices differ in color
-
-    printf("c CNF: %ld-coloring of %d vertices, %d edges\n", k, n, m);
-    printf("p cnf %d %lld\n", num_vars, num_clauses);
-
-    /* 1. Every vertex is assigned at least one color:
-    For each vertex v ∈ V, the following clause must be satisfied:
-    (x_v,1 ∨ x_v,2 ∨ ... ∨ x_v,k) */
-    for (int v = 1; v <= n; v++) {
-        for (int i = 1; i <= k; i++) {
-            printf("%ld ", (v - 1) * k + i);
+    C2sGraph *g = NULL;
+    C2sGraph shape = { 0 };
+    long long line = 0;
+    PhaseTimes times = { { 0 }, { 0 }, NULL, { { { 0 } } } };
+    C2sPerfSample readCounts[2];
+    if (perfMode) {
+        times.perf = c2s_perf_open();
+        if (times.perf == NULL) {
+            fprintf(stderr, "c perf counters unavailable: %s%s\n", strerror(errno),
+                    errno == EACCES || errno == EPERM ? " (see kernel.perf_event_paranoid)"
+                                                      : " (no hardware PMU, e.g. in a VM)");
         }
-        printf("0\n");
+    }
+    int timed = jsonlFile || stats || traceFile || times.perf || estimate;
+    if (times.perf)
+        c2s_perf_sample(times.perf, &readCounts[0]);
+    double parseStart = timed ? now() : 0;
+    long long estBytes[C2S_ENC_COUNT];
+    int rc = C2S_OK;
+    if (estimate && singlePass) {
+        rc = c2s_encoding_bytes_stream(graphFile, k, estBytes, &shape, &line);
+        g = &shape;
+    } else if (!singlePass) {
+        /* the single-pass encoder reads the graph while it writes the CNF */
+        rc = c2s_graph_read(graphFile, &g, &line);
+    }
+    double parse = timed ? now() - parseStart : 0;
+    if (times.perf)
+        c2s_perf_sample(times.perf, &readCounts[1]);
+    if (rc == C2S_ERR_IO) {
+        ERROR_EXIT("Error opening file %s\n", graphFile);
+    } else if (rc == C2S_ERR_FORMAT || rc == C2S_ERR_EDGE) {
+        ERROR_EXIT("Line %lld: %s.\n", line, c2s_strerror(rc));
+    } else if (rc == C2S_ERR_OVERFLOW) {
+        ERROR_EXIT("%s has more than %d vertices or edges, more than a graph in memory holds; --single-pass and "
+                   "--pipeline have 64-bit counts.\n", graphFile, INT_MAX);
+    } else if (rc != C2S_OK) {
+        ERROR_EXIT("Reading the graph failed: %s.\n", c2s_strerror(rc));
+    }
+    if (g && g->m != g->declaredM) {
+        ERROR("Warning: read %lld edges, expected %lld.\nResetting edge count and continuing...", g->m,
+              g->declaredM);
+    }
+    if (g && !estimate) {
+        rc = c2s_encoding_check(g, k, encoding, maxVars);
+        if (rc != C2S_OK)
+            reject_cnf(g, k, encoding, rc, maxVars, target);
+    }
+    if (estimate) {
+        for (int encoding = 0; encoding < C2S_ENC_COUNT && !singlePass; encoding++)
+            estBytes[encoding] = c2s_encoding_bytes(g, k, encoding, NULL);
+        print_estimate(g, k, parse, estBytes);
+        if (!singlePass)
+            c2s_graph_free(g);
+        return EXIT_SUCCESS;
     }
 
-    /* 2. Every vertex is assigned at most one color:
-    For each vertex v ∈ V and for every possible pair of colors {c_i, c_j}, 
-    the following clause must be satisfied:
-    ¬x_v,ci ∨ ¬x_v,cj */    
-    for (int v = 1; v <= n; v++) {
-        for (int i = 1; i <= k; i++) {
-            for (int j = i + 1; j <= k; j++) {
-                printf("-%ld -%ld 0\n", (v - 1) * k + i, (v - 1) * k + j);
+    int fd = STDOUT_FILENO;
+    C2sFanout *fan = NULL;
+    if (outFile) {
+        fd = open(outFile, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            ERROR_EXIT("Error opening output file %s\n", outFile);
+        }
+    } else if (fanout) {
+        /* the destinations are the descriptors 3 .. fanout+2 set up by the caller */
+        int fds[64];
+        for (int i = 0; i < fanout; i++) {
+            fds[i] = 3 + i;
+            if (fcntl(fds[i], F_GETFD) < 0) {
+                ERROR_EXIT("--fanout %d: descriptor %d is not open\n", fanout, fds[i]);
             }
         }
+        /* a consumer that exits early is dropped by the fan-out, it must not kill the encoder */
+        signal(SIGPIPE, SIG_IGN);
+        fan = c2s_fanout_start(fds, fanout, &fd);
+        if (fan == NULL) {
+            ERROR_EXIT("Starting the fan-out failed\n%s", "");
+        }
     }
-
-    /* 3. Every adjacent vertices have different colors:
-    For each edge {u, w} ∈ E and for each possible color c, 
-    the following clause must be satisfied:
-    ¬x_u,c ∨ ¬x_w,c */
-    for (int e = 0; e < m; e++) {
-        int u = edges[e][0];
-        int v = edges[e][1];
-        for (int i = 1; i <= k; i++) {
-            printf("-%ld -%ld 0\n", (u - 1) * k + i, (v - 1) * k + i);
+    C2sPhaseFn observer = timed ? on_phase : NULL;
+    if (pipeline) {
+        rc = c2s_encode_dimacs_pipelined(graphFile, k, encoding, maxVars, fd, ioMode, observer, &times, &shape,
+                                         &line);
+        g = &shape;
+    } else if (sorted) {
+        rc = c2s_encode_dimacs_sorted(graphFile, k, encoding, maxVars, fd, ioMode, observer, &times, &shape,
+                                      &line, &sortOpts);
+        g = &shape;
+        /* reading and sorting end where the CNF begins */
+        if (rc == C2S_OK && timed)
+            parse = times.start[C2S_PHASE_ALO] - parseStart;
+    } else if (singlePass) {
+        rc = c2s_encode_dimacs_stream(graphFile, k, encoding, maxVars, fd, ioMode, observer, &times, &shape,
+                                      &line);
+        g = &shape;
+    } else {
+        rc = c2s_encode_dimacs_observed(g, k, encoding, fd, ioMode, observer, &times);
+    }
+    if (rc != C2S_OK && jsonlFile)
+        write_jsonl(jsonlFile, graphFile, g, k, encoding, parse, &times, EXIT_FAILURE);
+    if (rc == C2S_ERR_IO && g->n == 0) {
+        ERROR_EXIT("Error opening file %s\n", graphFile);
+    } else if (rc == C2S_ERR_FORMAT || rc == C2S_ERR_EDGE) {
+        ERROR_EXIT("Line %lld: %s.\n", line, c2s_strerror(rc));
+    } else if (rc == C2S_ERR_OVERFLOW || rc == C2S_ERR_LIMIT) {
+        reject_cnf(g, k, encoding, rc, maxVars, target);
+    } else if (rc == C2S_ERR_IO && sorted && g->m == 0 && sortOpts.edgesRead > 0) {
+        /* the sort failed before the CNF began */
+        ERROR_EXIT("Spilling the sorted edges to %s failed\n",
+                   sortOpts.tmpDir ? sortOpts.tmpDir : "the temporary directory");
+    } else if (rc != C2S_OK) {
+        ERROR_EXIT("Writing the CNF failed: %s.\n", c2s_strerror(rc));
+    }
+    if (sorted && sortOpts.edgesRead != g->declaredM) {
+        ERROR("Warning: read %lld edges, expected %lld.\n", sortOpts.edgesRead, g->declaredM);
+    } else if (singlePass && !sorted && g->m != g->declaredM) {
+        ERROR("Warning: read %lld edges, expected %lld.\nRewrote the CNF header for %lld edges.\n", g->m,
+              g->declaredM, g->m);
+    }
+    if (outFile && close(fd) < 0) {
+        ERROR_EXIT("Error closing output file %s\n", outFile);
+    }
+    if (fan) {
+        close(fd);
+        if (c2s_fanout_finish(fan) < 0) {
+            ERROR_EXIT("Fan-out failed, no consumer received the whole CNF\n%s", "");
         }
     }
+    if (jsonlFile && write_jsonl(jsonlFile, graphFile, g, k, encoding, parse, &times, EXIT_SUCCESS) < 0) {
+        ERROR_EXIT("Error writing %s\n", jsonlFile);
+    }
+    if (traceFile && write_trace(traceFile, g, k, encoding, parseStart, parse, &times) < 0) {
+        ERROR_EXIT("Error writing %s\n", traceFile);
+    }
+    if (stats)
+        print_stats(g, k, encoding, parse, &times, sorted ? &sortOpts : NULL);
+    if (times.perf) {
+        print_perf(times.perf, g, k, encoding, readCounts, &times);
+        c2s_perf_close(times.perf);
+    }
 
-    free_graph(g);
+    if (!singlePass)
+        c2s_graph_free(g);
     return EXIT_SUCCESS;
 }
 
 static void usage(void) {
-    fprintf(stderr, "Usage: %s <input_graph.col | -> <k>\nThe program reads a graph in DIMACS format from stdin and transforms it into a CNF for k-colorability\n", progName);
+    fprintf(stderr, "Usage: %s [-o <output.cnf> | --fanout <N>] [--io auto|uring|thread|sync] [--jsonl <file>] [--stats] [--perf] [--trace <file>] [--encoding <variant>] [--estimate] [--single-pass | --pipeline | --external-sort [--mem-budget <size>] [--tmp-dir <dir>]] [--max-vars <N|int|kissat|minisat|none>] <input_graph.col | -> <k>\nThe program reads a graph in DIMACS format from stdin and transforms it into a CNF for k-colorability\n"
+                    "--fanout N writes the CNF to the descriptors 3 .. N+2 (e.g. pipes to N solvers) instead of stdout\n"
+                    "--jsonl FILE appends a JSON line with parse and emit times, CNF size and peak RSS to FILE\n"
+                    "--stats prints per-phase timings, throughput and input statistics to stderr\n"
+                    "--perf prints per-phase hardware counters (perf_event_open) to stderr\n"
+                    "--trace FILE appends the phases as Chrome trace events to FILE\n"
+                    "--encoding direct|no-amo|seq-amo[+sym] selects the at-most-one clauses and symmetry breaking\n"
+                    "--estimate prints variables, clauses and bytes of the CNF of every encoding instead of writing it;\n"
+                    "  with --single-pass without keeping the edges\n"
+                    "--single-pass writes the clauses of every edge as it is read, in memory independent of the edge count\n"
+                    "--pipeline is --single-pass with the parsing on a reader thread, overlapping it with the emission\n"
+                    "--external-sort sorts the edges and drops duplicates within --mem-budget (default 1G), spilling runs to --tmp-dir\n"
+                    "--max-vars rejects a CNF with more variables than the target solver reads (default int: 2147483647)\n",
+            progName);
     exit(EXIT_FAILURE);
 }
 
-static Graph *read_graph(const char *file) {
-    FILE *fp = NULL;
-    if (strcmp(file, "-") == 0) {
-        fp = stdin;
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void on_phase(void *user, int phase, unsigned long long bytes) {
+    PhaseTimes *t = user;
+    t->start[phase] = now();
+    t->bytes[phase] = bytes;
+    if (t->perf)
+        c2s_perf_sample(t->perf, &t->counts[phase]);
+}
+
+static int write_jsonl(const char *path, const char *graphFile, const C2sGraph *g, long k, int encoding,
+                       double parse, const PhaseTimes *t, int status) {
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *line = open_memstream(&buf, &len);
+    if (line == NULL)
+        return -1;
+    const char *run = getenv("C2S_RUN_ID");
+    double end = t->start[C2S_PHASE_DONE] > 0 ? t->start[C2S_PHASE_DONE] : now();
+
+    fputs("{\"run\":", line);
+    if (run)
+        json_string(line, run);
+    else
+        fputs("null", line);
+    fprintf(line, ",\"tool\":\"color2sat\",\"pid\":%ld,\"graph\":", (long)getpid());
+    json_string(line, graphFile);
+    fprintf(line, ",\"k\":%ld,\"phase\":\"encode\",\"encoding\":\"%s\",\"n\":%lld,\"m\":%lld,\"vars\":%lld,"
+                  "\"clauses\":%lld,\"parse_s\":%.6f,\"emit_s\":%.6f,\"flush_s\":%.6f,\"bytes\":%llu,\"maxrss_kb\":%ld,"
+                  "\"exit\":%d}\n",
+            k, c2s_encoding_name(encoding), g->n, g->m, c2s_encoding_vars(g, k, encoding),
+            c2s_encoding_clauses(g, k, encoding), parse, end - t->start[C2S_PHASE_ALO],
+            end - t->start[C2S_PHASE_FLUSH], t->bytes[C2S_PHASE_DONE], peak_rss_kb(), status);
+    if (fclose(line) != 0) {
+        free(buf);
+        return -1;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    ssize_t w = fd < 0 ? -1 : write(fd, buf, len);
+    int err = errno;
+    if (fd >= 0 && close(fd) < 0 && w == (ssize_t)len) {
+        err = errno;
+        w = -1;
+    }
+    free(buf);
+    errno = err;
+    return w == (ssize_t)len ? 0 : -1;
+}
+
+static void print_stats(const C2sGraph *g, long k, int encoding, double parse, const PhaseTimes *t,
+                        const C2sSortOptions *sort) {
+    static const char *const labels[] = { "alo block", "amo block", "edge block", "flush" };
+    long selfLoops = 0;
+    long duplicates = 0;
+
+    /* a single-pass run parses the edges in the edge block and keeps none to look for duplicates in */
+    if (g->edges) {
+        duplicates = count_duplicate_edges(g, &selfLoops);
+        fprintf(stderr, "c stats %-12s %10.6f s  %12.0f edges/s\n", "read_graph", parse,
+                parse > 0 ? g->m / parse : 0.0);
+    } else if (sort) {
+        fprintf(stderr, "c stats %-12s %10.6f s  %12.0f edges/s  %d runs spilled, %d merge passes\n", "read+sort",
+                parse, parse > 0 ? sort->edgesRead / parse : 0.0, sort->runs, sort->mergePasses);
     } else {
-        fp = fopen(file, "r");
-        if (!fp) {
-            ERROR_EXIT("Error opening file %s\n", file);
-        }
+        fprintf(stderr, "c stats %-12s single pass, parsed in the edge block\n", "read_graph");
     }
+    for (int p = C2S_PHASE_ALO; p < C2S_PHASE_FLUSH; p++) {
+        double sec = t->start[p + 1] - t->start[p];
+        double mb = (t->bytes[p + 1] - t->bytes[p]) / 1e6;
+        fprintf(stderr, "c stats %-12s %10.6f s  %12.0f clauses/s  %9.1f MB/s\n", labels[p], sec,
+                sec > 0 ? c2s_phase_clauses(g, k, encoding, p) / sec : 0.0, sec > 0 ? mb / sec : 0.0);
+    }
+    fprintf(stderr, "c stats %-12s %10.6f s\n", labels[C2S_PHASE_FLUSH],
+            t->start[C2S_PHASE_DONE] - t->start[C2S_PHASE_FLUSH]);
+    double emit = t->start[C2S_PHASE_DONE] - t->start[C2S_PHASE_ALO];
+    double mb = t->bytes[C2S_PHASE_DONE] / 1e6;
+    fprintf(stderr, "c stats %-12s %10.6f s  %12.0f clauses/s  %9.1f MB/s  %llu bytes\n", "emit total", emit,
+            emit > 0 ? c2s_encoding_clauses(g, k, encoding) / emit : 0.0, emit > 0 ? mb / emit : 0.0, t->bytes[C2S_PHASE_DONE]);
+    fprintf(stderr, "c stats peak_rss %ld KiB\n", peak_rss_kb());
+    if (g->edges)
+        fprintf(stderr, "c stats ignored_lines %lld duplicate_edges %ld self_loops %ld\n", g->ignoredLines,
+                duplicates, selfLoops);
+    else if (sort)
+        fprintf(stderr, "c stats ignored_lines %lld duplicate_edges %lld\n", g->ignoredLines,
+                sort->edgesRead - g->m);
+    else
+        fprintf(stderr, "c stats ignored_lines %lld\n", g->ignoredLines);
+}
 
-    char line[256];
-    int n = 0, m = 0;
+static void print_perf(const C2sPerf *perf, const C2sGraph *g, long k, int encoding, const C2sPerfSample read[2],
+                       const PhaseTimes *t) {
+    static const char *const labels[] = { "alo block", "amo block", "edge block", "flush" };
+    print_perf_line(perf, "read_graph", &read[0], &read[1], g->m, "edge");
+    for (int p = C2S_PHASE_ALO; p < C2S_PHASE_DONE; p++)
+        print_perf_line(perf, labels[p], &t->counts[p], &t->counts[p + 1], c2s_phase_clauses(g, k, encoding, p),
+                        "clause");
+    print_perf_line(perf, "emit total", &t->counts[C2S_PHASE_ALO], &t->counts[C2S_PHASE_DONE],
+                    c2s_encoding_clauses(g, k, encoding), "clause");
+}
 
-    /* parse problem line */
-    while (fgets(line, sizeof(line), fp)) {
-        if (line[0] == 'p') {
-            if (sscanf(line, "p edge %d %d", &n, &m) != 2) {
-                ERROR_EXIT("Invalid problem line format.\n%s", "");
-            }
-            break;
+static void print_perf_line(const C2sPerf *perf, const char *label, const C2sPerfSample *from,
+                            const C2sPerfSample *to, long long units, const char *unit) {
+    unsigned long long d[C2S_PERF_EVENTS];
+    for (int e = 0; e < C2S_PERF_EVENTS; e++)
+        d[e] = to->value[e] - from->value[e];
+    fprintf(stderr, "c perf %-12s", label);
+    for (int e = 0; e < C2S_PERF_EVENTS; e++) {
+        if (c2s_perf_has(perf, e))
+            fprintf(stderr, " %s %llu", c2s_perf_event_name(e), d[e]);
+    }
+    if (c2s_perf_has(perf, C2S_PERF_CYCLES) && c2s_perf_has(perf, C2S_PERF_INSTRUCTIONS) && d[C2S_PERF_CYCLES] > 0)
+        fprintf(stderr, " IPC %.2f", (double)d[C2S_PERF_INSTRUCTIONS] / d[C2S_PERF_CYCLES]);
+    if (units > 0) {
+        for (int e = C2S_PERF_CACHE_MISSES; e <= C2S_PERF_BRANCH_MISSES; e++) {
+            if (c2s_perf_has(perf, e))
+                fprintf(stderr, " %s/%s %.4f", c2s_perf_event_name(e), unit, (double)d[e] / units);
         }
     }
-    if (n <= 0 || m < 0) {
-        ERROR_EXIT("Invalid n or m: %d vertices, %d edges.\n", n, m);
-    }
-
-    Graph *g = malloc(sizeof(*g));
-    if (!g) 
-        ERROR_EXIT("Alloc Graph failed.\n%s", "");
-    g->n = n;
-    g->m = m;
-    g->edges = malloc(m * sizeof(*g->edges));
-    if (!g->edges) 
-        ERROR_EXIT("Alloc edges failed.\n%s", "");
-
-    int count = 0;
-    while (fgets(line, sizeof(line), fp)) {
-        if (line[0] == 'e' && count < m) {
-            int u, v;
-            if (sscanf(line, "e %d %d", &u, &v) == 2) {
-                g->edges[count][0] = u;
-                g->edges[count][1] = v;
-                count++;
-            } 
-        } else {
-            ERROR_EXIT("%d: Line [%s]\nInvalid edge line format or count exceeding problem size.\n", count, line);
+    fputc('\n', stderr);
+}
+
+static int write_trace(const char *path, const C2sGraph *g, long k, int encoding, double parseStart, double parse,
+                       const PhaseTimes *t) {
+    static const char *const names[] = { "alo block", "amo block", "edge block", "flush" };
+    char args[128];
+    C2sTrace *trace = c2s_trace_open(path, "color2sat");
+    if (trace == NULL)
+        return -1;
+    snprintf(args, sizeof(args), "\"k\":%ld,\"bytes\":%llu", k, t->bytes[C2S_PHASE_DONE]);
+    c2s_trace_span(trace, "color2sat", parseStart, t->start[C2S_PHASE_DONE], args);
+    snprintf(args, sizeof(args), "\"n\":%lld,\"edges\":%lld", g->n, g->m);
+    c2s_trace_span(trace, "read_graph", parseStart, parseStart + parse, args);
+    for (int p = C2S_PHASE_ALO; p < C2S_PHASE_FLUSH; p++) {
+        snprintf(args, sizeof(args), "\"bytes\":%llu,\"clauses\":%lld", t->bytes[p + 1] - t->bytes[p],
+                 c2s_phase_clauses(g, k, encoding, p));
+        c2s_trace_span(trace, names[p], t->start[p], t->start[p + 1], args);
+    }
+    /* waiting for the last writes shows a slow disk or a consumer that does not keep up */
+    c2s_trace_span(trace, names[C2S_PHASE_FLUSH], t->start[C2S_PHASE_FLUSH], t->start[C2S_PHASE_DONE], NULL);
+    return c2s_trace_close(trace);
+}
+
+static void print_estimate(const C2sGraph *g, long k, double parse, const long long *bytes) {
+    printf("c estimate %lld vertices, %lld edges, k=%ld, read in %.3f s\n", g->n, g->m, k, parse);
+    printf("%-12s %16s %16s %20s\n", "encoding", "vars", "clauses", "bytes");
+    for (int encoding = 0; encoding < C2S_ENC_COUNT; encoding++) {
+        const char *name = c2s_encoding_name(encoding);
+        if (name && c2s_encoding_check(g, k, encoding, 0) == C2S_ERR_OVERFLOW)
+            printf("%-12s %16s\n", name, "overflow");
+        else if (name)
+            printf("%-12s %16lld %16lld %20lld\n", name, c2s_encoding_vars(g, k, encoding),
+                   c2s_encoding_clauses(g, k, encoding), bytes[encoding]);
+    }
+}
+
+static size_t parse_size(const char *arg) {
+    char *end;
+    errno = 0;
+    unsigned long long size = strtoull(arg, &end, 10);
+    int shift = 0;
+    if (*end == 'K' || *end == 'k')
+        shift = 10;
+    else if (*end == 'M' || *end == 'm')
+        shift = 20;
+    else if (*end == 'G' || *end == 'g')
+        shift = 30;
+    if (shift)
+        end++;
+    if (end == arg || *end != '\0' || errno != 0 || size > (SIZE_MAX >> shift))
+        return 0;
+    return (size_t)(size << shift);
+}
+
+static long long parse_max_vars(const char *arg, const char **target) {
+    for (size_t i = 0; i < sizeof(varLimits) / sizeof(varLimits[0]); i++) {
+        if (strcmp(arg, varLimits[i].name) == 0) {
+            *target = varLimits[i].name;
+            return varLimits[i].maxVars;
         }
     }
-    if (count != m) {
-        ERROR("Warning: read %d edges, expected %d.\nResetting edge count and continuing...", count, m);
-        g->m = count;
+    *target = NULL;
+    char *end;
+    errno = 0;
+    long long maxVars = strtoll(arg, &end, 10);
+    return *end != '\0' || errno != 0 || maxVars <= 0 ? -1 : maxVars;
+}
+
+static void reject_cnf(const C2sGraph *g, long k, int encoding, int rc, long long maxVars, const char *target) {
+    if (rc == C2S_ERR_LIMIT && !target) {
+        ERROR_EXIT("The %s CNF of %lld vertices with k=%ld has %lld variables, more than --max-vars %lld allows.\n",
+                   c2s_encoding_name(encoding), g->n, k, c2s_encoding_vars(g, k, encoding), maxVars);
+    }
+    if (rc == C2S_ERR_LIMIT) {
+        ERROR_EXIT("The %s CNF of %lld vertices with k=%ld has %lld variables, the target %s reads at most %lld; "
+                   "see --max-vars.\n", c2s_encoding_name(encoding), g->n, k, c2s_encoding_vars(g, k, encoding),
+                   target, maxVars);
+    }
+    ERROR_EXIT("The %s CNF of %lld vertices and %lld edges with k=%ld has more variables, clauses or bytes than "
+               "a 64-bit count holds.\n", c2s_encoding_name(encoding), g->n, g->declaredM, k);
+}
+
+static long count_duplicate_edges(const C2sGraph *g, long *selfLoops) {
+    *selfLoops = 0;
+    unsigned long long *keys = malloc(((size_t)g->m + 1) * sizeof(*keys));
+    if (keys == NULL)
+        return -1;
+    for (int e = 0; e < g->m; e++) {
+        unsigned long long u = g->edges[e][0], v = g->edges[e][1];
+        *selfLoops += u == v;
+        keys[e] = u < v ? u << 32 | v : v << 32 | u;
     }
-    return g;
+    qsort(keys, g->m, sizeof(*keys), cmp_ull);
+    long duplicates = 0;
+    for (int e = 1; e < g->m; e++)
+        duplicates += keys[e] == keys[e - 1];
+    free(keys);
+    return duplicates;
 }
 
-static void free_graph(Graph *g) {
-    free(g->edges);
-    free(g);
+static int cmp_ull(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long *)a, y = *(const unsigned long long *)b;
+    return (x > y) - (x < y);
+}
+
+static long peak_rss_kb(void) {
+    long kb = -1;
+    char buf[256];
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status != NULL) {
+        while (kb < 0 && fgets(buf, sizeof(buf), status) != NULL)
+            sscanf(buf, "VmHWM: %ld", &kb);
+        fclose(status);
+    }
+    if (kb < 0) {
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        kb = ru.ru_maxrss;
+    }
+    return kb;
+}
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+            fprintf(f, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(f, "\\u%04x", c);
+        else
+            fputc(c, f);
+    }
+    fputc('"', f);
 }
@@ -5,9 +5,23 @@ then solve it with kissat, saving both the CNF and solution to specified directo
 Written by ChatGPT, prompted by Michael Helm, 11810354@student.tuwien.ac.at
 """
 import argparse
+import atexit
+import fcntl
+import shutil
+import signal
 import subprocess
 import os
+import queue
 import sys
+import tempfile
+import threading
+import time
+
+import batch
+import phaselog
+import pycolor2sat
+import resultcache
+import solvers
 
 
 def main():
@@ -16,10 +30,12 @@ def main():
     )
     parser.add_argument(
         'input_graph',
+        nargs='?',
         help='Path to DIMACS formatted graph file (.col)'
     )
     parser.add_argument(
         'k',
+        nargs='?',
         type=int,
         help='Number of colors'
     )
@@ -43,7 +59,153 @@ def main():
         default='sol',
         help='Directory to save solution .out files'
     )
+    parser.add_argument(
+        '--inprocess',
+        action='store_true',
+        help='Encode with libcolor2sat.so in this process instead of running color2sat'
+    )
+    parser.add_argument(
+        '--stream',
+        action='store_true',
+        help='Pipe the CNF straight into kissat instead of writing it to cnf-dir first'
+    )
+    parser.add_argument(
+        '--tee-cnf',
+        metavar='PATH',
+        help='With --stream, also save a compressed copy of the CNF to PATH (.gz, .xz, .zst or .bz2)'
+    )
+    parser.add_argument(
+        '--ephemeral',
+        action='store_true',
+        help='Keep the CNF in an anonymous memory file (memfd or /dev/shm) instead of cnf-dir'
+    )
+    parser.add_argument(
+        '--portfolio',
+        action='store_true',
+        help='Race several solver configurations on the CNF; the first SAT/UNSAT answer wins'
+    )
+    parser.add_argument(
+        '--portfolio-members',
+        metavar='NAMES',
+        help='Comma separated portfolio members (default: all of ' +
+             ', '.join(m.name for m in solvers.DEFAULT_PORTFOLIO) + ')'
+    )
+    parser.add_argument(
+        '--minisat',
+        default='./binary_minisat/minisat_v1.14',
+        help='Path to the minisat executable used by the portfolio'
+    )
+    parser.add_argument(
+        '--satelite',
+        default='./binary_minisat/SatELite_v1.0_linux',
+        help='Path to the SatELite executable used by the portfolio'
+    )
+    parser.add_argument(
+        '--preprocess',
+        choices=['none', 'satelite', 'auto'],
+        help='Preprocess with SatELite before kissat and rebuild the full model (auto: per instance family, '
+             'whichever was faster so far); the stage times go to <sol-dir>/preprocess.csv'
+    )
+    parser.add_argument(
+        '--batch',
+        nargs='+',
+        metavar='GLOB',
+        help='Batch mode: solve every graph matching the globs for every k of --k-range'
+    )
+    parser.add_argument(
+        '--k-range',
+        metavar='K',
+        help="k values of the batch, e.g. '15', '5-20' or '5,7,10-12'"
+    )
+    parser.add_argument(
+        '--manifest',
+        metavar='FILE',
+        help="Batch mode: lines '<graph> <k-range>' ('#' comments), alone or in addition to --batch"
+    )
+    parser.add_argument(
+        '--jobs',
+        type=int,
+        default=max(1, len(os.sched_getaffinity(0))),
+        help='Batch mode: number of parallel jobs, each pinned to its own cores (default: one per core)'
+    )
+    parser.add_argument(
+        '--results',
+        default='results.jsonl',
+        help='Batch mode: JSONL file the results are appended to; jobs found there are skipped on resume'
+    )
+    parser.add_argument(
+        '--time-limit',
+        type=float,
+        help='Batch mode: wall clock seconds per job'
+    )
+    parser.add_argument(
+        '--cpu-limit',
+        type=int,
+        help='Batch mode: CPU seconds per process of a job (RLIMIT_CPU)'
+    )
+    parser.add_argument(
+        '--mem-limit',
+        metavar='SIZE',
+        help="Batch mode: address space per process of a job (RLIMIT_AS), e.g. '4G'"
+    )
+    parser.add_argument(
+        '--cache',
+        metavar='PATH',
+        help='Result cache <PATH>.log/<PATH>.idx: answer from earlier runs where possible and store new results'
+    )
+    parser.add_argument(
+        '--encoding',
+        choices=pycolor2sat.ENCODINGS,
+        default=resultcache.ENCODING,
+        help='CNF encoding variant of color2sat: at-most-one clauses pairwise, left out or as a sequential '
+             'counter, optionally with symmetry breaking (default: %(default)s)'
+    )
+    parser.add_argument(
+        '--jsonl',
+        metavar='FILE',
+        help='Append machine-readable JSON lines with the encode/solve/decode times, sizes, peak RSS, exit '
+             'code and verdict to FILE; color2sat adds its own parse/emit record'
+    )
+    parser.add_argument(
+        '--trace',
+        metavar='FILE',
+        help='Append Chrome trace events of the wrapper phases, color2sat and every solver process to FILE '
+             '(open in Perfetto or about:tracing)'
+    )
+    # set by batch mode for its job children
+    parser.add_argument('--job-cpus', help=argparse.SUPPRESS)
+    parser.add_argument('--job-cpu-limit', type=int, help=argparse.SUPPRESS)
+    parser.add_argument('--job-mem-limit', type=int, help=argparse.SUPPRESS)
     args = parser.parse_args()
+    if args.job_cpus or args.job_cpu_limit or args.job_mem_limit:
+        cpus = {int(c) for c in args.job_cpus.split(',')} if args.job_cpus else None
+        batch.apply_limits(args.job_cpu_limit, args.job_mem_limit, cpus)
+    if args.batch or args.manifest:
+        if args.input_graph is not None:
+            parser.error('batch mode takes its graphs from --batch and --manifest, not as arguments')
+        batch.run_batch(args, forwarded_options(args))
+        return
+    if args.input_graph is None or args.k is None:
+        parser.error('input_graph and k are required')
+    args.phase_log = phaselog.PhaseLog(args.jsonl, graph=args.input_graph, k=args.k)
+    if args.trace:
+        phaselog.trace = phaselog.Trace(args.trace)
+        atexit.register(phaselog.trace.flush)
+    # turn SIGTERM (e.g. from timeout) into SystemExit, so running solvers are cleaned up
+    signal.signal(signal.SIGTERM, lambda signum, frame: sys.exit(128 + signum))
+    if args.preprocess and (args.stream or args.portfolio):
+        parser.error('--preprocess needs a CNF file and a single solver; use it without --stream and --portfolio')
+    if args.portfolio and args.stream and args.tee_cnf:
+        parser.error('--tee-cnf is not supported with --portfolio')
+    try:
+        members = solvers.select_members(args.portfolio_members)
+    except ValueError as e:
+        parser.error(str(e))
+    # reject a CNF the solvers cannot read before encoding it
+    if args.portfolio:
+        args.max_vars = solvers.max_vars_target(m.kind for m in members)
+    else:
+        args.max_vars = solvers.max_vars_target(['kissat', 'satelite'] if args.preprocess else ['kissat'])
 
     # Ensure output directories exist
     os.makedirs(args.cnf_dir, exist_ok=True)
@@ -56,12 +218,329 @@ def main():
     cnf_path = os.path.join(args.cnf_dir, cnf_filename)
     sol_path = os.path.join(args.sol_dir, sol_filename)
 
-    # Generate CNF file
-    print(f"Generating CNF for '{base}' with k={args.k}' into '{cnf_path}'...")
+    cache = None
+    if args.cache:
+        cache = resultcache.ResultCache(args.cache)
+        ghash, n = resultcache.graph_hash(args.input_graph)
+        solver_id = solver_key(args, members)
+        rec = cache.lookup(ghash, args.k, args.encoding, solver_id)
+        if rec is not None:
+            answer_from_cache(args, rec, n, sol_path)
+            args.phase_log.record('cache', verdict=rec['verdict'], cached_k=rec['k'], solver=rec['solver'])
+            return
+
+    start = time.monotonic()
+    result, graph, tee_path, solver = solve(args, members, base, cnf_path, sol_path)
+    elapsed = time.monotonic() - start
+
+    # Interpret the solver exit code
+    ret = result.returncode
+    if ret == 10:
+        print("Result: SATISFIABLE (exit code 10)")
+    elif ret == 20:
+        print("Result: UNSATISFIABLE (exit code 20)")
+    elif ret == 0:
+        print("Result: UNKNOWN or INTERRUPTED (exit code 0)")
+    else:
+        print(f"Result: {solver or 'solver'} terminated with exit code {ret}", file=sys.stderr)
+
+    if ret == 10 and graph is not None:
+        timer = phaselog.Timer()
+        used = report_coloring(graph, args.k, sol_path)
+        args.phase_log.record('decode', timer, colors=used)
+
+    if not args.stream and not args.ephemeral:
+        print(f"CNF saved to '{cnf_path}'")
+    elif tee_path:
+        print(f"Compressed CNF saved to '{tee_path}'")
+    print(f"Solution saved to '{sol_path}'")
+
+    if cache is not None and ret in (10, 20):
+        colors = None
+        if ret == 10:
+            with open(sol_path) as sol_f:
+                colors = resultcache.colors_from_model(pycolor2sat.parse_model(sol_f.read()), n, args.k)
+        cache.store(ghash, args.k, args.encoding, solver_id, 'SAT' if ret == 10 else 'UNSAT', colors,
+                    {'total': round(elapsed, 3)})
+
+
+def solver_key(args, members):
+    """Solver part of the cache key: the solver binaries and the options that choose between them."""
+    if args.portfolio:
+        paths = {'kissat': args.kissat, 'minisat': args.minisat, 'satelite': args.satelite}
+        names = [m.name + '=' + resultcache.solver_identity(paths['minisat' if m.kind == 'satelite' else m.kind])
+                 for m in members]
+        return 'portfolio(' + ','.join(sorted(names)) + ')'
+    ident = resultcache.solver_identity(args.kissat)
+    if args.preprocess in ('satelite', 'auto'):
+        ident += f"+preprocess-{args.preprocess}-" + resultcache.solver_identity(args.satelite)
+    return ident
+
+
+def answer_from_cache(args, rec, n, sol_path):
+    """Write the solution implied by a cached record for args.k, without running any solver."""
+    verdict = rec['verdict']
+    print(f"Result: {verdict}ISFIABLE (cached: {verdict} at k={rec['k']}, "
+          f"solved in {rec['timings'].get('total', 0):.2f} s by {rec['solver']})")
+    code = solvers.SAT if verdict == 'SAT' else solvers.UNSAT
+    model = ()
+    if verdict == 'SAT' and rec.get('colors'):
+        # a coloring with fewer colors is also a coloring for args.k
+        model = resultcache.model_from_colors(rec['colors'], args.k)
+    with open(sol_path, 'w') as sol_f:
+        sol_f.write(solvers.model_lines(model, code))
+    if verdict == 'SAT' and args.inprocess and model:
+        report_coloring(load_graph_inprocess(args.input_graph), args.k, sol_path)
+    print(f"Solution saved to '{sol_path}'")
+
+
+def solve(args, members, base, cnf_path, sol_path):
+    """
+    Encode and solve in the mode selected by the options.
+    @return (result with the solver exit code in returncode, graph loaded in process or None, tee path or None,
+             name of the solver that ran: kissat, kissat+preprocess-<mode> or the winning portfolio member, None if
+             no member won)
+    """
+    log = args.phase_log
+    graph = None
+    tee_path = None
+    if args.ephemeral:
+        cnf_fd = create_ephemeral_cnf(args, base)
+        timer = phaselog.Timer()
+        if args.inprocess:
+            graph = load_graph_inprocess(args.input_graph)
+            check_max_vars(args, graph)
+        print(f"Generating CNF for '{base}' with k={args.k} in memory...")
+        if graph is not None:
+            encode_graph_to_fd(graph, args.k, cnf_fd, args.encoding)
+        else:
+            encode_subprocess(args, cnf_fd)
+        log_encode(log, timer, graph, args, os.fstat(cnf_fd).st_size)
+        timer = phaselog.Timer()
+        if args.portfolio:
+            result = run_portfolio(args, members, base, f"/proc/self/fd/{cnf_fd}", sol_path, (cnf_fd,))
+        elif args.preprocess:
+            result = run_preprocess(args, base, f"/proc/self/fd/{cnf_fd}", sol_path, (cnf_fd,))
+        else:
+            print("Running kissat on the in-memory CNF...")
+            result = run_solver_on_fd(args.kissat, cnf_fd, sol_path)
+        os.close(cnf_fd)
+    elif args.stream and args.portfolio:
+        timer = phaselog.Timer()
+        print(f"Streaming CNF for '{base}' with k={args.k} into {len(members)} solvers...")
+        if args.inprocess:
+            graph = load_graph_inprocess(args.input_graph)
+            check_max_vars(args, graph)
+        result = run_portfolio(args, members, base, None, sol_path, fanout=True)
+    elif args.stream:
+        timer = phaselog.Timer()
+        tee_path = args.tee_cnf
+        print(f"Streaming CNF for '{base}' with k={args.k} into kissat...")
+        if args.inprocess:
+            graph = load_graph_inprocess(args.input_graph)
+            check_max_vars(args, graph)
+        result = solve_streaming(args, graph, sol_path, tee_path)
+    else:
+        # Generate CNF file
+        print(f"Generating CNF for '{base}' with k={args.k}' into '{cnf_path}'...")
+        timer = phaselog.Timer()
+        if args.inprocess:
+            graph = encode_inprocess(args, cnf_path)
+        else:
+            encode_subprocess(args, cnf_path)
+        log_encode(log, timer, graph, args, os.path.getsize(cnf_path))
+
+        timer = phaselog.Timer()
+        if args.portfolio:
+            result = run_portfolio(args, members, base, cnf_path, sol_path)
+        elif args.preprocess:
+            result = run_preprocess(args, base, cnf_path, sol_path)
+        else:
+            result = run_kissat(args.kissat, cnf_path, sol_path)
+
+    # in stream mode the solve phase includes the encoding that runs alongside
+    solver = os.path.basename(args.kissat)
+    if args.portfolio:
+        solver = result.args  # the winning member
+    elif args.preprocess:
+        solver += f"+preprocess-{result.args}"
+    log.record('solve', timer, getattr(result, 'usage', None), streamed=args.stream,
+               solver=solver, exit=result.returncode,
+               verdict=phaselog.VERDICTS.get(result.returncode, 'UNKNOWN'))
+    return result, graph, tee_path, solver
+
+
+def log_encode(log, timer, graph, args, size):
+    """Record the encode phase; the CNF dimensions are known here only for an in-process graph."""
+    fields = {}
+    if graph is not None:
+        fields.update(vars=graph.num_vars(args.k, args.encoding), clauses=graph.num_clauses(args.k, args.encoding))
+    log.record('encode', timer, **fields, encoding=args.encoding, inprocess=graph is not None, bytes=size)
+
+
+def color2sat_command(args, *options):
+    """
+    The color2sat command line for the graph and k of args, with --encoding, --jsonl and --trace passed on and
+    --max-vars set for the solvers of the run.
+    """
+    options += ('--max-vars', args.max_vars)
+    if args.encoding != resultcache.ENCODING:
+        options += ('--encoding', args.encoding)
+    if args.jsonl:
+        options += ('--jsonl', args.jsonl)
+    if args.trace:
+        options += ('--trace', args.trace)
+    return [args.color2sat, *options, args.input_graph, str(args.k)]
+
+def forwarded_options(args):
+    """Command line options of a single run that batch mode passes on to its job children."""
+    forward = ['--color2sat', args.color2sat, '--kissat', args.kissat, '--cnf-dir', args.cnf_dir,
+               '--sol-dir', args.sol_dir, '--minisat', args.minisat, '--satelite', args.satelite]
+    for flag in ('inprocess', 'stream', 'ephemeral', 'portfolio'):
+        if getattr(args, flag):
+            forward.append('--' + flag)
+    if args.portfolio_members:
+        forward += ['--portfolio-members', args.portfolio_members]
+    if args.preprocess:
+        forward += ['--preprocess', args.preprocess]
+    if args.encoding != resultcache.ENCODING:
+        forward += ['--encoding', args.encoding]
+    if args.tee_cnf:
+        forward += ['--tee-cnf', args.tee_cnf]
+    if args.cache:
+        forward += ['--cache', os.path.abspath(args.cache)]
+    if args.jsonl:
+        forward += ['--jsonl', os.path.abspath(args.jsonl)]
+    if args.trace:
+        forward += ['--trace', os.path.abspath(args.trace)]
+    return forward
+
+
+def run_kissat(kissat, cnf_path, sol_path):
+    """Run kissat on a CNF file; exits if kissat cannot be started."""
+    print(f"Running kissat on '{cnf_path}'...")
+    return run_solver([kissat, cnf_path], sol_path)
+
+
+def run_solver(argv, sol_path, pass_fds=()):
+    """
+    Run a solver with its output in sol_path; exits if it cannot be started.
+    @return CompletedProcess with the rusage of the solver from wait4 in .usage
+    """
+    start = time.monotonic()
+    try:
+        with open(sol_path, 'w') as sol_f:
+            proc = subprocess.Popen(argv, stdout=sol_f, stderr=subprocess.PIPE, pass_fds=pass_fds, text=True)
+    except FileNotFoundError:
+        print(f"Error: '{argv[0]}' not found or not executable.", file=sys.stderr)
+        sys.exit(1)
+    stderr = proc.stderr.read()
+    proc.stderr.close()
+    usage = phaselog.wait4(proc)
+    phaselog.trace.span('solve', start, pid=proc.pid, process=os.path.basename(argv[0]), exit=proc.returncode)
+    result = subprocess.CompletedProcess(argv, proc.returncode, stderr=stderr)
+    result.usage = usage
+    return result
+
+
+def run_preprocess(args, base, cnf, sol_path, pass_fds=()):
+    """Solve with or without SatELite preprocessing as selected by --preprocess and log the stage times."""
+    log_path = os.path.join(args.sol_dir, 'preprocess.csv')
+    mode = args.preprocess
+    if mode == 'auto':
+        mode = solvers.choose_preprocess(log_path, base)
+        print(f"Preprocessing for family '{solvers.instance_family(base)}': {mode}")
+    paths = solvers.SolverPaths(args.kissat, args.minisat, args.satelite)
+    if mode == 'satelite':
+        print("Running SatELite and kissat on the reduced CNF...")
+        try:
+            code, times = solvers.solve_preprocessed(paths, cnf, sol_path, pass_fds)
+        except (OSError, RuntimeError) as e:
+            print(f"Error: {e}", file=sys.stderr)
+            sys.exit(1)
+        print(f"Stage times: preprocess {times['preprocess']:.2f} s, solve {times['solve']:.2f} s, "
+              f"extend {times['extend']:.2f} s")
+    else:
+        start = time.monotonic()
+        if pass_fds:
+            code = run_solver_on_fd(args.kissat, pass_fds[0], sol_path).returncode
+        else:
+            code = run_kissat(args.kissat, cnf, sol_path).returncode
+        times = {'solve': time.monotonic() - start}
+    solvers.record_preprocess(log_path, base, args.k, mode, code, times)
+    return subprocess.CompletedProcess(mode, code)
+
+
+def run_portfolio(args, members, base, cnf, sol_path, pass_fds=(), fanout=False):
+    """
+    Race the portfolio members on cnf and log the winner to <sol-dir>/portfolio.csv.
+    With fanout, the members read their stdin instead and a single color2sat --fanout feeds all of them.
+    """
+    paths = solvers.SolverPaths(args.kissat, args.minisat, args.satelite)
+    for path in {paths.kissat, paths.minisat, paths.satelite}:
+        if not os.access(path, os.X_OK):
+            print(f"Error: '{path}' not found or not executable.", file=sys.stderr)
+            sys.exit(1)
+    print(f"Racing {len(members)} solvers: {', '.join(m.name for m in members)}...")
+    if not fanout:
+        winner, code, elapsed, usage = solvers.race(members, paths, cnf, sol_path, pass_fds)
+    else:
+        pipes = [os.pipe() for _ in members]
+        encoder = []
+
+        def start_encoder_fanout():
+            for r, _ in pipes:
+                os.close(r)
+            encoder.append(start_fanout_encoder(args, [w for _, w in pipes]))
+            for _, w in pipes:
+                os.close(w)
+            return encoder[0]
+        winner, code, elapsed, usage = solvers.race(members, paths, None, sol_path,
+                                                    stdins=[r for r, _ in pipes], feeder=start_encoder_fanout)
+        ret = encoder[0].wait()
+        if ret != 0 and winner is None:
+            print(f"Error: color2sat failed (exit code {ret})", file=sys.stderr)
+            print(encoder[0].stderr.read().decode(errors='replace'), file=sys.stderr)
+            sys.exit(ret)
+    solvers.record_win(os.path.join(args.sol_dir, 'portfolio.csv'), base, args.k, members, winner, code, elapsed)
+    if winner is None:
+        print("No portfolio member reached a definitive answer.")
+    else:
+        print(f"Winner: {winner} after {elapsed:.2f} s")
+    result = subprocess.CompletedProcess(winner, code)
+    result.usage = usage
+    return result
+
+
+def start_fanout_encoder(args, write_fds):
+    """Start color2sat --fanout N with write_fds moved to the descriptors 3 .. N+2."""
+    n = len(write_fds)
+
+    def move_fds():
+        # go through descriptors above the target range, so no target overwrites a source
+        high = [fcntl.fcntl(fd, fcntl.F_DUPFD, 3 + n) for fd in write_fds]
+        for i, fd in enumerate(high):
+            os.dup2(fd, 3 + i)
+            os.close(fd)
+    try:
+        return subprocess.Popen(
+            color2sat_command(args, '--fanout', str(n)),
+            stdout=subprocess.DEVNULL,
+            stderr=subprocess.PIPE,
+            close_fds=False,  # only the moved descriptors are inheritable, Python opens everything else O_CLOEXEC
+            preexec_fn=move_fds
+        )
+    except FileNotFoundError:
+        print(f"Error: '{args.color2sat}' not found or not executable.", file=sys.stderr)
+        sys.exit(1)
+
+
+def encode_subprocess(args, cnf_path):
+    """Run color2sat with its output redirected into cnf_path (a path or an open descriptor); exits on failure."""
     try:
-        with open(cnf_path, 'w') as cnf_f:
+        with open(cnf_path, 'w', closefd=not isinstance(cnf_path, int)) as cnf_f:
             result = subprocess.run(
-                [args.color2sat, args.input_graph, str(args.k)],
+                color2sat_command(args),
                 stdout=cnf_f,
                 stderr=subprocess.PIPE,
                 text=True
@@ -74,33 +553,294 @@ def main():
         print(f"Error: '{args.color2sat}' not found or not executable.", file=sys.stderr)
         sys.exit(1)
 
-    # Run kissat solver
-    print(f"Running kissat on '{cnf_path}'...")
+
+def load_graph_inprocess(input_graph):
+    """Load the graph with libcolor2sat; exits on failure."""
+    try:
+        return pycolor2sat.Graph.from_file(input_graph)
+    except OSError as e:
+        print(f"Error: cannot use libcolor2sat.so ({e}); run 'make lib'.", file=sys.stderr)
+        sys.exit(1)
+    except pycolor2sat.Color2SatError as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
+
+
+def check_max_vars(args, graph):
+    """Exit like color2sat --max-vars if the solvers of the run cannot read the CNF of a loaded graph."""
+    limit = solvers.MAX_VARS[args.max_vars]
+    num_vars = graph.num_vars(args.k, args.encoding)
+    if num_vars > limit:
+        print(f"Error: the {args.encoding} CNF of {graph.n} vertices with k={args.k} has {num_vars} variables, "
+              f"the target {args.max_vars} reads at most {limit}.", file=sys.stderr)
+        sys.exit(1)
+
+
+def encode_inprocess(args, cnf_path):
+    """Encode with libcolor2sat into cnf_path; returns the loaded graph for decoding. Exits on failure."""
+    graph = load_graph_inprocess(args.input_graph)
+    check_max_vars(args, graph)
+    with open(cnf_path, 'wb') as cnf_f:
+        encode_graph_to_fd(graph, args.k, cnf_f.fileno(), args.encoding)
+    return graph
+
+
+def encode_graph_to_fd(graph, k, fd, encoding):
+    """Encode a loaded graph into fd; exits on failure."""
+    try:
+        graph.encode_to_fd(k, fd, encoding=encoding)
+    except pycolor2sat.Color2SatError as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
+
+
+def predict_cnf_size(args):
+    """
+    Exact size in bytes of the color2sat output for the graph, k and encoding of args, from color2sat --estimate.
+    The graph is read but never encoded.
+    """
+    out = subprocess.run([args.color2sat, '--estimate', args.input_graph, str(args.k)], check=True,
+                         capture_output=True, text=True).stdout
+    for line in out.splitlines():
+        fields = line.split()
+        if fields and fields[0] == args.encoding:
+            return int(fields[3])
+    raise ValueError(f"color2sat --estimate has no size for encoding '{args.encoding}'")
+
+
+def available_memory():
+    """Bytes that can be put into memory files: MemAvailable, bounded by free /dev/shm space if any."""
+    avail = None
+    with open('/proc/meminfo') as f:
+        for line in f:
+            if line.startswith('MemAvailable:'):
+                avail = int(line.split()[1]) * 1024
+    try:
+        st = os.statvfs('/dev/shm')
+        shm = st.f_bavail * st.f_frsize
+        avail = shm if avail is None else min(avail, shm)
+    except OSError:
+        pass
+    return avail
+
+
+def create_ephemeral_cnf(args, base):
+    """
+    Check that the predicted CNF fits into memory and create an anonymous file for it: a memfd, or an
+    unlinked file in /dev/shm where memfd_create is missing. Exits if the CNF would not fit.
+    """
+    try:
+        size = predict_cnf_size(args)
+    except (OSError, subprocess.CalledProcessError, ValueError) as e:
+        print(f"Error: estimating the CNF size failed: {e}", file=sys.stderr)
+        sys.exit(1)
+    avail = available_memory()
+    print(f"Predicted CNF size: {size / 2**20:.1f} MiB, available memory: {avail / 2**20:.1f} MiB")
+    if avail is not None and size > avail * 0.9:
+        print("Error: the CNF does not fit into memory; run without --ephemeral.", file=sys.stderr)
+        sys.exit(1)
+    name = f"{base}_{args.k}k.cnf"
+    if hasattr(os, 'memfd_create'):
+        return os.memfd_create(name)
+    fd, path = tempfile.mkstemp(prefix=name, dir='/dev/shm')
+    os.unlink(path)
+    return fd
+
+
+def run_solver_on_fd(solver, cnf_fd, sol_path):
+    """
+    Run a solver on the file behind cnf_fd through /proc/self/fd/N. Every solver opens its own file
+    description there, so several solvers can read the same memory file at once.
+    """
+    return run_solver([solver, f"/proc/self/fd/{cnf_fd}"], sol_path, (cnf_fd,))
+
+
+# Compressors for --tee-cnf, chosen by file suffix
+COMPRESSORS = {
+    '.gz': ['gzip', '-1', '-c'],
+    '.xz': ['xz', '-1', '-T0', '-c'],
+    '.zst': ['zstd', '-1', '-T0', '-q', '-c'],
+    '.bz2': ['bzip2', '-1', '-c'],
+}
+
+# 1 MiB chunks a --tee-cnf compressor may fall behind kissat before it holds up the stream
+TEE_QUEUE_CHUNKS = 256
+
+
+def start_encoder(args, graph):
+    """
+    Start producing the CNF on a pipe. Returns (read_fd, finish) where finish() waits for the
+    encoder and exits with an error message if it failed.
+    """
+    if graph is not None:
+        read_fd, write_fd = os.pipe()
+        errors = []
+
+        def encode():
+            try:
+                graph.encode_to_fd(args.k, write_fd, io='thread', encoding=args.encoding)
+            except pycolor2sat.Color2SatError as e:
+                errors.append(e)
+            finally:
+                os.close(write_fd)
+
+        thread = threading.Thread(target=encode, daemon=True)
+        thread.start()
+
+        def finish():
+            thread.join()
+            if errors:
+                print(f"Error: {errors[0]}", file=sys.stderr)
+                sys.exit(1)
+        return read_fd, finish
+
+    try:
+        enc = subprocess.Popen(
+            color2sat_command(args),
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE
+        )
+    except FileNotFoundError:
+        print(f"Error: '{args.color2sat}' not found or not executable.", file=sys.stderr)
+        sys.exit(1)
+    # keep stderr drained so a chatty encoder cannot block
+    stderr = []
+    drain = threading.Thread(target=lambda: stderr.append(enc.stderr.read()), daemon=True)
+    drain.start()
+
+    def finish():
+        ret = enc.wait()
+        drain.join()
+        if ret != 0:
+            print(f"Error: color2sat failed (exit code {ret})", file=sys.stderr)
+            print(stderr[0].decode(errors='replace'), file=sys.stderr)
+            sys.exit(ret)
+    read_fd = os.dup(enc.stdout.fileno())
+    enc.stdout.close()
+    return read_fd, finish
+
+
+class BackgroundSink:
+    """
+    Writes to a sink on a thread of its own, so that a slow sink (e.g. a compressor) lags behind instead
+    of holding up the other sinks of copy_stream(). write() blocks only once max_chunks writes are queued.
+    """
+
+    def __init__(self, sink, max_chunks=TEE_QUEUE_CHUNKS):
+        self.sink = sink
+        self.chunks = queue.Queue(max_chunks)
+        self.broken = False
+        self.thread = threading.Thread(target=self._run, daemon=True)
+        self.thread.start()
+
+    def _run(self):
+        while True:
+            chunk = self.chunks.get()
+            if chunk is None:
+                break
+            if self.broken:
+                continue  # keep draining so write() never blocks on a dead sink
+            try:
+                self.sink.write(chunk)
+            except BrokenPipeError:
+                self.broken = True
+        try:
+            self.sink.close()
+        except BrokenPipeError:
+            pass
+
+    def write(self, chunk):
+        if self.broken:
+            raise BrokenPipeError
+        self.chunks.put(chunk)
+
+    def close(self):
+        """Wait until every queued chunk is written, then close the sink."""
+        self.chunks.put(None)
+        self.thread.join()
+
+
+def copy_stream(src_fd, sinks):
+    """Copy everything from src_fd to all sink file objects, dropping sinks that close early."""
+    with os.fdopen(src_fd, 'rb', buffering=0) as src:
+        while True:
+            chunk = src.read(1 << 20)
+            if not chunk:
+                break
+            for sink in list(sinks):
+                try:
+                    sink.write(chunk)
+                except BrokenPipeError:
+                    sinks.remove(sink)
+    for sink in sinks:
+        try:
+            sink.close()
+        except BrokenPipeError:
+            pass
+
+
+def solve_streaming(args, graph, sol_path, tee_path):
+    """
+    Feed the CNF to kissat over its stdin while it is being encoded, so kissat parses while the encoder
+    still formats. If tee_path is set, a compressor writes a copy in the background: it is fed by a thread of
+    its own and may fall up to TEE_QUEUE_CHUNKS MiB behind before it slows kissat down.
+    Returns the CompletedProcess-like result of kissat.
+    """
+    read_fd, finish = start_encoder(args, graph)
+    start = time.monotonic()
+    compressor = None
+    tee_file = None
     try:
         with open(sol_path, 'w') as sol_f:
-            result = subprocess.run(
-                [args.kissat, cnf_path],
-                stdout=sol_f,
-                stderr=subprocess.PIPE,
-                text=True
-            )
+            if not tee_path:
+                # no copy needed: kissat reads the encoder pipe directly
+                kissat = subprocess.Popen([args.kissat], stdin=read_fd, stdout=sol_f,
+                                          stderr=subprocess.DEVNULL)
+                os.close(read_fd)
+            else:
+                suffix = os.path.splitext(tee_path)[1]
+                cmd = COMPRESSORS.get(suffix)
+                if cmd is None or shutil.which(cmd[0]) is None:
+                    print(f"Error: no compressor for '{tee_path}' (use one of {', '.join(COMPRESSORS)}).",
+                          file=sys.stderr)
+                    sys.exit(1)
+                tee_file = open(tee_path, 'wb')
+                compressor = subprocess.Popen(cmd, stdin=subprocess.PIPE, stdout=tee_file)
+                kissat = subprocess.Popen([args.kissat], stdin=subprocess.PIPE, stdout=sol_f,
+                                          stderr=subprocess.DEVNULL)
+                copy_stream(read_fd, [kissat.stdin, BackgroundSink(compressor.stdin)])
+            usage = phaselog.wait4(kissat)
+            phaselog.trace.span('parse+solve', start, pid=kissat.pid, process=os.path.basename(args.kissat),
+                                exit=kissat.returncode)
     except FileNotFoundError:
         print(f"Error: '{args.kissat}' not found or not executable.", file=sys.stderr)
         sys.exit(1)
+    finish()
+    if compressor is not None:
+        compressor.wait()
+        tee_file.close()
+    result = subprocess.CompletedProcess(args.kissat, kissat.returncode)
+    result.usage = usage
+    return result
 
-    # Interpret kissat exit code
-    ret = result.returncode
-    if ret == 10:
-        print("Result: SATISFIABLE (exit code 10)")
-    elif ret == 20:
-        print("Result: UNSATISFIABLE (exit code 20)")
-    elif ret == 0:
-        print("Result: UNKNOWN or INTERRUPTED (exit code 0)")
-    else:
-        print(f"Result: kissat terminated with exit code {ret}", file=sys.stderr)
 
-    print(f"CNF saved to '{cnf_path}'")
-    print(f"Solution saved to '{sol_path}'")
+def report_coloring(graph, k, sol_path):
+    """
+    Decode the model in the solver output and check that it is a proper coloring.
+    @return Number of colors used, or None if there is no model or it is not a coloring.
+    """
+    with open(sol_path) as sol_f:
+        model = pycolor2sat.parse_model(sol_f.read())
+    if not model:
+        print("No model in the solver output, coloring not checked")
+        return None
+    try:
+        colors = graph.decode(k, model)
+        print(f"Coloring verified: {len(set(colors))} colors used")
+        return len(set(colors))
+    except pycolor2sat.Color2SatError as e:
+        print(f"Warning: {e}", file=sys.stderr)
+        return None
 
 if __name__ == '__main__':
     main()
@@ -0,0 +1,265 @@
+#!/usr/bin/env python3
+"""
+Encoding x solver matrix: solve every (graph, k) of a manifest with every color2sat encoding variant and
+every solver, each run under a time limit, and score the configurations by the time to a verdict including
+the encoding. The result is a PAR-2 table (unsolved runs count twice the time limit) and cactus plot data,
+which is how the defaults of combined_script.py are picked.
+
+    encoding_matrix.py --manifest instances.txt --timeout 300
+    encoding_matrix.py --batch 'graphinstances/le450_5*.col' --k-range 5 --solvers kissat,minisat
+
+Runs are sequential, so they do not compete for cores or memory bandwidth. Every run is appended to the
+runs CSV at once; an interrupted matrix resumes where it stopped.
+"""
+import argparse
+import csv
+import os
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+import batch
+import pycolor2sat
+import solvers
+from resultcache import colors_from_model
+
+RUN_FIELDS = ['graph', 'k', 'encoding', 'solver', 'timeout', 'status', 'encode_s', 'solve_s', 'total_s',
+              'vars', 'clauses', 'bytes']
+
+
+def read_graph(path):
+    """Vertex count and edge list of a DIMACS .col file."""
+    n, edges = 0, []
+    with open(path) as f:
+        for line in f:
+            if line.startswith('p'):
+                n = int(line.split()[2])
+            elif line.startswith('e'):
+                u, v = map(int, line.split()[1:3])
+                edges.append((u, v))
+    return n, edges
+
+
+def cnf_header(path):
+    """(vars, clauses) of the problem line of a CNF."""
+    with open(path) as f:
+        for line in f:
+            if line.startswith('p'):
+                _, _, nvars, nclauses = line.split()
+                return int(nvars), int(nclauses)
+    return 0, 0
+
+
+def encode(args, graph, k, encoding, cnf, max_vars):
+    """
+    Run color2sat into cnf within the time limit.
+    @param max_vars The --max-vars target of the solvers that will read cnf.
+    @return Wall clock seconds, or None if the encoder failed or ran out of time.
+    """
+    start = time.monotonic()
+    try:
+        subprocess.run([args.color2sat, '--encoding', encoding, '--max-vars', max_vars, '-o', cnf, graph, str(k)],
+                       check=True, stderr=subprocess.DEVNULL, timeout=args.timeout)
+    except (subprocess.CalledProcessError, subprocess.TimeoutExpired):
+        return None
+    return time.monotonic() - start
+
+
+def run_solver(member, paths, cnf, budget, workdir):
+    """
+    Run one solver on cnf in a session of its own, killed with its children after budget seconds.
+    @return (exit code or None on timeout, wall clock seconds, model literals of a SAT answer)
+    """
+    argv, result_path = solvers.member_command(member, paths, cnf, workdir)
+    out_path = os.path.join(workdir, member.name + '.out')
+    start = time.monotonic()
+    with open(out_path, 'w') as out:
+        proc = subprocess.Popen(argv, stdout=out, stderr=subprocess.DEVNULL, start_new_session=True)
+    try:
+        code = proc.wait(timeout=max(budget, 0.001))
+    except subprocess.TimeoutExpired:
+        code = None
+        os.killpg(proc.pid, signal.SIGKILL)
+        proc.wait()
+    elapsed = time.monotonic() - start
+    model = []
+    if code == solvers.SAT:
+        if result_path is None:
+            with open(out_path) as f:
+                model = pycolor2sat.parse_model(f.read())
+        elif member.kind == 'satelite':
+            files = solvers.SatEliteFiles(workdir, member.name)
+            try:
+                model = solvers.satelite_extend(paths, cnf, files, result_path)
+            except RuntimeError:
+                model = []
+        else:
+            model = pycolor2sat.parse_model(solvers.minisat_to_kissat(result_path, code))
+    return code, elapsed, model
+
+
+def status_of(code, model, n, edges, k):
+    """SAT or UNSAT for a definite answer, WRONG for a model that is not a coloring, TIMEOUT or ERROR."""
+    if code is None:
+        return 'TIMEOUT'
+    if code == solvers.UNSAT:
+        return 'UNSAT'
+    if code != solvers.SAT:
+        return 'ERROR'
+    colors = colors_from_model(model, n, k)
+    if colors is None or any(colors[u - 1] == colors[v - 1] for u, v in edges):
+        return 'WRONG'
+    return 'SAT'
+
+
+def load_runs(path, timeout):
+    """Rows of an earlier run of the matrix with the same time limit, keyed by (graph, k, encoding, solver)."""
+    runs = {}
+    if os.path.exists(path):
+        with open(path, newline='') as f:
+            for row in csv.DictReader(f):
+                if float(row['timeout']) == timeout:
+                    runs[(row['graph'], int(row['k']), row['encoding'], row['solver'])] = row
+    return runs
+
+
+def run_matrix(args, jobs, members, runs):
+    """Run every missing (job, encoding, solver) combination and append it to the runs CSV."""
+    paths = solvers.SolverPaths(args.kissat, args.minisat, args.satelite)
+    new = not os.path.exists(args.runs)
+    with open(args.runs, 'a', newline='') as f, tempfile.TemporaryDirectory(prefix='matrix-') as workdir:
+        writer = csv.DictWriter(f, RUN_FIELDS)
+        if new:
+            writer.writeheader()
+        for graph, k in jobs:
+            n, edges = read_graph(graph)
+            for encoding in args.encodings:
+                todo = [m for m in members if (graph, k, encoding, m.name) not in runs]
+                if not todo:
+                    continue
+                cnf = os.path.join(workdir, 'matrix.cnf')
+                encode_s = encode(args, graph, k, encoding, cnf, solvers.max_vars_target(m.kind for m in todo))
+                nvars, nclauses = cnf_header(cnf) if encode_s is not None else (0, 0)
+                size = os.path.getsize(cnf) if encode_s is not None else 0
+                for member in todo:
+                    if encode_s is None:
+                        status, solve_s = 'TIMEOUT', 0.0
+                    else:
+                        code, solve_s, model = run_solver(member, paths, cnf, args.timeout - encode_s, workdir)
+                        status = status_of(code, model, n, edges, k)
+                    row = {'graph': graph, 'k': k, 'encoding': encoding, 'solver': member.name,
+                           'timeout': args.timeout, 'status': status, 'encode_s': f"{encode_s or 0:.3f}",
+                           'solve_s': f"{solve_s:.3f}", 'total_s': f"{(encode_s or 0) + solve_s:.3f}",
+                           'vars': nvars, 'clauses': nclauses, 'bytes': size}
+                    writer.writerow(row)
+                    f.flush()
+                    runs[(graph, k, encoding, member.name)] = row
+                    print(f"{os.path.basename(graph)} k={k} {encoding:<12} {member.name:<18} {status:<7} "
+                          f"{row['total_s']:>9} s", flush=True)
+                if os.path.exists(cnf):
+                    os.unlink(cnf)
+
+
+def score(args, jobs, members, runs):
+    """
+    PAR-2 per configuration over all jobs: the total time of a solved run, twice the time limit otherwise.
+    @return [(encoding, solver, solved, par2, sorted solved times)], best PAR-2 first.
+    """
+    table = []
+    for encoding in args.encodings:
+        for member in members:
+            times, penalty = [], 0.0
+            for graph, k in jobs:
+                row = runs.get((graph, k, encoding, member.name))
+                if row is not None and row['status'] in ('SAT', 'UNSAT'):
+                    times.append(float(row['total_s']))
+                else:
+                    penalty += 2 * args.timeout
+            par2 = (sum(times) + penalty) / len(jobs)
+            table.append((encoding, member.name, len(times), par2, sorted(times)))
+    return sorted(table, key=lambda entry: entry[3])
+
+
+def check_answers(jobs, runs):
+    """Warn about jobs with SAT and UNSAT answers and about wrong models."""
+    for graph, k in jobs:
+        rows = [r for key, r in runs.items() if key[:2] == (graph, k)]
+        verdicts = {r['status'] for r in rows} & {'SAT', 'UNSAT'}
+        if len(verdicts) > 1:
+            print(f"Warning: {graph} k={k} has SAT and UNSAT answers", file=sys.stderr)
+        for r in rows:
+            if r['status'] == 'WRONG':
+                print(f"Warning: {graph} k={k} {r['encoding']} {r['solver']}: the model is not a coloring",
+                      file=sys.stderr)
+
+
+def write_reports(args, table, jobs):
+    """Print the PAR-2 table and write it and the cactus data as CSV."""
+    print(f"\n{len(jobs)} instances, time limit {args.timeout:g} s, PAR-2 = mean time with unsolved runs at "
+          f"{2 * args.timeout:g} s")
+    print(f"{'encoding':<12} {'solver':<18} {'solved':>7} {'PAR-2':>10}")
+    for encoding, solver, solved, par2, _ in table:
+        print(f"{encoding:<12} {solver:<18} {solved:>3}/{len(jobs):<3} {par2:>10.3f}")
+    with open(args.par2, 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(['encoding', 'solver', 'instances', 'solved', 'par2_s'])
+        for encoding, solver, solved, par2, _ in table:
+            writer.writerow([encoding, solver, len(jobs), solved, f"{par2:.3f}"])
+    # cactus plot: x = number of instances solved, y = time limit needed for that many
+    with open(args.cactus, 'w', newline='') as f:
+        writer = csv.writer(f)
+        writer.writerow(['encoding', 'solver', 'solved', 'seconds'])
+        for encoding, solver, _, _, times in table:
+            for i, seconds in enumerate(times, 1):
+                writer.writerow([encoding, solver, i, f"{seconds:.3f}"])
+    print(f"PAR-2 table saved to '{args.par2}', cactus data to '{args.cactus}', runs in '{args.runs}'")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run every encoding variant with every solver and score them "
+                                                 "by PAR-2 of the time to a verdict.")
+    parser.add_argument('--batch', nargs='+', metavar='GLOB', help='Graphs to solve for every k of --k-range')
+    parser.add_argument('--k-range', metavar='K', help="k values, e.g. '15', '5-20' or '5,7,10-12'")
+    parser.add_argument('--manifest', metavar='FILE', help="Lines '<graph> <k-range>' ('#' comments)")
+    parser.add_argument('--encodings', default=','.join(pycolor2sat.ENCODINGS),
+                        help='Comma separated encoding variants (default: all)')
+    parser.add_argument('--solvers', default='kissat,minisat,satelite+minisat',
+                        help='Comma separated solvers, names of portfolio members (default: %(default)s)')
+    parser.add_argument('--timeout', type=float, default=300, help='Seconds per run, encoding included '
+                                                                    '(default: %(default)s)')
+    parser.add_argument('--runs', default='matrix_runs.csv', help='CSV with one row per run; rows with the same '
+                                                                  'timeout are reused (default: %(default)s)')
+    parser.add_argument('--par2', default='matrix_par2.csv', help='PAR-2 table (default: %(default)s)')
+    parser.add_argument('--cactus', default='matrix_cactus.csv', help='Cactus plot data (default: %(default)s)')
+    parser.add_argument('--color2sat', default='./color2sat', help='Path to the color2sat executable')
+    parser.add_argument('--kissat', default='./kissat', help='Path to the kissat executable')
+    parser.add_argument('--minisat', default='./binary_minisat/minisat_v1.14', help='Path to minisat')
+    parser.add_argument('--satelite', default='./binary_minisat/SatELite_v1.0_linux', help='Path to SatELite')
+    args = parser.parse_args()
+
+    args.encodings = args.encodings.split(',')
+    unknown = [e for e in args.encodings if e not in pycolor2sat.ENCODINGS]
+    if unknown:
+        parser.error(f"unknown encoding(s) {', '.join(unknown)} (known: {', '.join(pycolor2sat.ENCODINGS)})")
+    try:
+        members = solvers.select_members(args.solvers)
+        jobs = batch.expand_jobs(args.batch, args.k_range, args.manifest)
+    except (OSError, ValueError) as e:
+        parser.error(str(e))
+    if not jobs:
+        parser.error('no instances; use --batch with --k-range and/or --manifest')
+
+    runs = load_runs(args.runs, args.timeout)
+    try:
+        run_matrix(args, jobs, members, runs)
+    except FileNotFoundError as e:
+        print(f"Error: '{e.filename}' not found or not executable.", file=sys.stderr)
+        sys.exit(1)
+    check_answers(jobs, runs)
+    write_reports(args, score(args, jobs, members, runs), jobs)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,715 @@
+/**
+ * @file gengraph.c
+ * @author Michael Helm
+ * @brief Seeded generator of DIMACS .col test graphs: G(n,p), G(n,m), Leighton-style, Culberson-style flat and
+ * random geometric graphs, written to a file or to stdout (e.g. straight into `color2sat - <k>`).
+ * @date 2026-10-16
+ *
+ * The output is a function of the parameters and the seed only. G(n,p) and geometric graphs are enumerated
+ * twice, once to count the edges for the problem line and once to print them, so they need no edge
+ * storage; G(n,m) and Leighton graphs deduplicate their edges in memory (16 bytes per edge while sorting);
+ * flat graphs know their edge count up front and are printed in a single pass.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+char *progName = "<not set>";
+
+/**
+ * Prints formatted error messages to stderr and terminates with EXIT_FAILURE.
+ * Global variables: progName.
+ * @param msg The error message as a formatted string, like in fprintf(...).
+ * @param ... Variable number of arguments for the formatted string msg.
+ */
+#define ERROR_EXIT( msg, ... )                                         \
+    {                                                                  \
+        fprintf(stderr, "[%s] [%s] ERROR: " msg, progName, strerror(errno), ##__VA_ARGS__); \
+        exit(EXIT_FAILURE);                                            \
+    }
+
+#define OUT_BUF_SIZE (1 << 20)
+
+/**
+ * xoshiro256** state.
+ */
+typedef struct {
+    uint64_t s[4];
+} Rng;
+
+/**
+ * Buffered output of "e u v" lines; counts the edges only while count is set.
+ */
+typedef struct {
+    int fd;
+    int count;
+    uint64_t edges;
+    size_t len;
+    char buf[OUT_BUF_SIZE];
+} Out;
+
+/**
+ * Print usage and exit.
+ */
+static void usage(void);
+
+/**
+ * Seed the generator by expanding seed with splitmix64.
+ */
+static void rng_seed(Rng *r, uint64_t seed);
+
+/**
+ * @return The next 64 random bits.
+ */
+static uint64_t rng_next(Rng *r);
+
+/**
+ * @return A uniform double in [0, 1).
+ */
+static double rng_double(Rng *r);
+
+/**
+ * @return A uniform integer in [0, bound), without modulo bias.
+ */
+static uint64_t rng_below(Rng *r, uint64_t bound);
+
+/**
+ * Append text to the output buffer.
+ */
+static void out_text(Out *o, const char *text, size_t len);
+
+/**
+ * Count or print the edge {u, v} of 0-based vertices.
+ */
+static void out_edge(Out *o, uint32_t u, uint32_t v);
+
+/**
+ * Write out the buffer.
+ */
+static void out_flush(Out *o);
+
+/**
+ * Print the comments and the problem line.
+ */
+static void out_header(Out *o, const char *comment, int n, uint64_t m);
+
+/**
+ * Enumerate G(n,p) with geometric skipping (Batagelj and Brandes 2005): O(n + m) time, no storage.
+ */
+static void gen_gnp(Out *o, Rng *r, int n, double p);
+
+/**
+ * Enumerate a random geometric graph: n uniform points in the unit square, an edge between points at
+ * distance at most radius. Points are bucketed in a grid of radius-sized cells.
+ */
+static void gen_geometric(Out *o, const double *x, const double *y, const uint32_t *cellStart,
+                          const uint32_t *order, int n, int grid, double radius);
+
+/**
+ * Sample m distinct edges uniformly from all pairs of n vertices.
+ * @return Sorted pair codes, see pair_code().
+ */
+static uint64_t *gen_gnm(Rng *r, int n, uint64_t m);
+
+/**
+ * Leighton-style graph with chromatic number k: the vertices are split into k equal color classes, one
+ * k-clique across the classes is planted, and random cliques of 2..k vertices from distinct classes are
+ * added until there are at least m edges. Clique size s is drawn with weight 1/(s choose 2), so every size
+ * contributes about the same number of edges.
+ * @param count Receives the number of edges.
+ * @return Sorted pair codes.
+ */
+static uint64_t *gen_leighton(Rng *r, int n, int k, uint64_t m, uint64_t *count);
+
+/**
+ * Culberson-style flat graph: k equal color classes, the m edges split evenly between the pairs of
+ * classes, and within a pair spread over perfect-matching-like diagonals with the lowest-degree vertices
+ * first, so all degrees stay within a few of each other.
+ */
+static void gen_flat(Out *o, Rng *r, int n, int k, uint64_t m);
+
+/**
+ * Code of the pair u < v: v(v-1)/2 + u, which orders the pairs by v, then u.
+ */
+static uint64_t pair_code(uint32_t u, uint32_t v);
+
+/**
+ * Inverse of pair_code().
+ */
+static void pair_decode(uint64_t code, uint32_t *u, uint32_t *v);
+
+/**
+ * Sort codes with an LSD radix sort over the bits below limit and drop duplicates.
+ * @return The number of distinct codes, now at the front of codes.
+ */
+static uint64_t sort_unique(uint64_t *codes, uint64_t count, uint64_t limit);
+
+/**
+ * Shuffle a[0 .. len) (Fisher-Yates).
+ */
+static void shuffle(Rng *r, uint32_t *a, uint32_t len);
+
+/**
+ * Shuffle a[0 .. len), then sort it stably by degree, so vertices of equal degree end up in random order.
+ * @param keys Scratch space for len keys.
+ * @param tmp Scratch space for len vertices.
+ */
+static void order_by_degree(Rng *r, uint32_t *a, uint32_t len, const uint32_t *degree, uint64_t *keys,
+                            uint32_t *tmp);
+
+/**
+ * qsort() comparison of two uint64_t.
+ */
+static int cmp_u64(const void *a, const void *b);
+
+int main(int argc, char *argv[]) {
+    progName = argv[0];
+
+    uint64_t seed = 1;
+    const char *outFile = NULL;
+    char *endptr = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:o:")) != -1) {
+        switch (opt) {
+        case 's':
+            seed = strtoull(optarg, &endptr, 10);
+            if (*endptr != '\0')
+                usage();
+            break;
+        case 'o':
+            outFile = optarg;
+            break;
+        default:
+            usage();
+        }
+    }
+    if (argc - optind < 3)
+        usage();
+    const char *family = argv[optind];
+    long n = strtol(argv[optind + 1], &endptr, 10);
+    if (*endptr != '\0' || n < 2 || n > INT32_MAX)
+        usage();
+    uint64_t allPairs = (uint64_t)n * (n - 1) / 2;
+
+    Out *o = malloc(sizeof(*o));
+    if (o == NULL) {
+        ERROR_EXIT("Out of memory\n%s", "");
+    }
+    o->fd = STDOUT_FILENO;
+    o->len = 0;
+    if (outFile) {
+        o->fd = open(outFile, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (o->fd < 0) {
+            ERROR_EXIT("Error opening output file %s\n", outFile);
+        }
+    }
+    Rng rng;
+    char comment[256];
+
+    if (strcmp(family, "gnp") == 0 && argc - optind == 3) {
+        double p = strtod(argv[optind + 2], &endptr);
+        if (*endptr != '\0' || p < 0 || p > 1)
+            usage();
+        snprintf(comment, sizeof(comment), "c gengraph gnp %ld %g seed %llu\n", n, p, (unsigned long long)seed);
+        /* first pass counts, the second prints the same edges */
+        o->count = 1;
+        o->edges = 0;
+        rng_seed(&rng, seed);
+        gen_gnp(o, &rng, (int)n, p);
+        out_header(o, comment, (int)n, o->edges);
+        o->count = 0;
+        rng_seed(&rng, seed);
+        gen_gnp(o, &rng, (int)n, p);
+    } else if (strcmp(family, "geometric") == 0 && argc - optind == 3) {
+        double radius = strtod(argv[optind + 2], &endptr);
+        if (*endptr != '\0' || radius <= 0)
+            usage();
+        snprintf(comment, sizeof(comment), "c gengraph geometric %ld %g seed %llu\n", n, radius,
+                 (unsigned long long)seed);
+        /* cells of at least radius, at most about 2 points per cell on average */
+        long grid = (long)(1.0 / radius);
+        long maxGrid = (long)sqrt((double)n / 2) + 1;
+        if (grid > maxGrid)
+            grid = maxGrid;
+        if (grid < 1)
+            grid = 1;
+        double *x = malloc(n * sizeof(*x));
+        double *y = malloc(n * sizeof(*y));
+        uint32_t *cellStart = calloc(grid * grid + 1, sizeof(*cellStart));
+        uint32_t *order = malloc(n * sizeof(*order));
+        if (!x || !y || !cellStart || !order) {
+            ERROR_EXIT("Out of memory\n%s", "");
+        }
+        rng_seed(&rng, seed);
+        for (long i = 0; i < n; i++) {
+            x[i] = rng_double(&rng);
+            y[i] = rng_double(&rng);
+            cellStart[(long)(x[i] * grid) * grid + (long)(y[i] * grid) + 1]++;
+        }
+        for (long c = 0; c < grid * grid; c++)
+            cellStart[c + 1] += cellStart[c];
+        uint32_t *fill = malloc((grid * grid + 1) * sizeof(*fill));
+        if (fill == NULL) {
+            ERROR_EXIT("Out of memory\n%s", "");
+        }
+        memcpy(fill, cellStart, (grid * grid + 1) * sizeof(*fill));
+        for (long i = 0; i < n; i++)
+            order[fill[(long)(x[i] * grid) * grid + (long)(y[i] * grid)]++] = (uint32_t)i;
+        free(fill);
+        o->count = 1;
+        o->edges = 0;
+        gen_geometric(o, x, y, cellStart, order, (int)n, (int)grid, radius);
+        out_header(o, comment, (int)n, o->edges);
+        o->count = 0;
+        gen_geometric(o, x, y, cellStart, order, (int)n, (int)grid, radius);
+        free(x);
+        free(y);
+        free(cellStart);
+        free(order);
+    } else if (strcmp(family, "gnm") == 0 && argc - optind == 3) {
+        uint64_t m = strtoull(argv[optind + 2], &endptr, 10);
+        if (*endptr != '\0' || m > allPairs)
+            usage();
+        snprintf(comment, sizeof(comment), "c gengraph gnm %ld %llu seed %llu\n", n, (unsigned long long)m,
+                 (unsigned long long)seed);
+        rng_seed(&rng, seed);
+        uint64_t *codes = gen_gnm(&rng, (int)n, m);
+        out_header(o, comment, (int)n, m);
+        o->count = 0;
+        for (uint64_t e = 0; e < m; e++) {
+            uint32_t u, v;
+            pair_decode(codes[e], &u, &v);
+            out_edge(o, u, v);
+        }
+        free(codes);
+    } else if ((strcmp(family, "leighton") == 0 || strcmp(family, "flat") == 0) && argc - optind == 4) {
+        long k = strtol(argv[optind + 2], &endptr, 10);
+        if (*endptr != '\0' || k < 2 || k > n)
+            usage();
+        uint64_t m = strtoull(argv[optind + 3], &endptr, 10);
+        if (*endptr != '\0')
+            usage();
+        /* only pairs of vertices in different classes can be edges */
+        uint64_t maxEdges = allPairs;
+        for (long c = 0; c < k; c++) {
+            uint64_t size = n / k + (c < n % k);
+            maxEdges -= size * (size - 1) / 2;
+        }
+        if (m > maxEdges) {
+            errno = EINVAL;
+            ERROR_EXIT("At most %llu edges fit between %ld color classes of %ld vertices\n",
+                       (unsigned long long)maxEdges, k, n);
+        }
+        rng_seed(&rng, seed);
+        if (family[0] == 'l') {
+            uint64_t count;
+            uint64_t *codes = gen_leighton(&rng, (int)n, (int)k, m, &count);
+            snprintf(comment, sizeof(comment),
+                     "c gengraph leighton %ld %ld %llu seed %llu\nc chromatic number %ld (planted %ld-clique)\n", n,
+                     k, (unsigned long long)m, (unsigned long long)seed, k, k);
+            out_header(o, comment, (int)n, count);
+            o->count = 0;
+            for (uint64_t e = 0; e < count; e++) {
+                uint32_t u, v;
+                pair_decode(codes[e], &u, &v);
+                out_edge(o, u, v);
+            }
+            free(codes);
+        } else {
+            snprintf(comment, sizeof(comment),
+                     "c gengraph flat %ld %ld %llu seed %llu\nc chromatic number at most %ld (planted coloring)\n", n,
+                     k, (unsigned long long)m, (unsigned long long)seed, k);
+            out_header(o, comment, (int)n, m);
+            o->count = 0;
+            gen_flat(o, &rng, (int)n, (int)k, m);
+        }
+    } else {
+        usage();
+    }
+
+    out_flush(o);
+    if (outFile && close(o->fd) < 0) {
+        ERROR_EXIT("Error closing output file %s\n", outFile);
+    }
+    free(o);
+    return EXIT_SUCCESS;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: %s [-s <seed>] [-o <output.col>] <family> <n> <parameters>\n"
+                    "  gnp <n> <p>              random graph, every pair is an edge with probability p\n"
+                    "  gnm <n> <m>              random graph with exactly m distinct edges\n"
+                    "  leighton <n> <k> <m>     about m edges, chromatic number exactly k (planted k-clique)\n"
+                    "  flat <n> <k> <m>         m edges, near-equal degrees, k-colorable (planted coloring)\n"
+                    "  geometric <n> <r>        n random points in the unit square, edges up to distance r\n"
+                    "Writes a DIMACS .col graph to stdout; the same seed gives the same graph\n", progName);
+    exit(EXIT_FAILURE);
+}
+
+static uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static void rng_seed(Rng *r, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        r->s[i] = z ^ (z >> 31);
+    }
+}
+
+static uint64_t rng_next(Rng *r) {
+    uint64_t *s = r->s;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+    return result;
+}
+
+static double rng_double(Rng *r) {
+    return (rng_next(r) >> 11) * 0x1.0p-53;
+}
+
+static uint64_t rng_below(Rng *r, uint64_t bound) {
+    uint64_t threshold = -bound % bound;
+    for (;;) {
+        uint64_t x = rng_next(r);
+        if (x >= threshold)
+            return x % bound;
+    }
+}
+
+static void out_text(Out *o, const char *text, size_t len) {
+    if (o->len + len > OUT_BUF_SIZE)
+        out_flush(o);
+    memcpy(o->buf + o->len, text, len);
+    o->len += len;
+}
+
+static void out_edge(Out *o, uint32_t u, uint32_t v) {
+    if (o->count) {
+        o->edges++;
+        return;
+    }
+    if (o->len + 32 > OUT_BUF_SIZE)
+        out_flush(o);
+    char tmp[12];
+    char *p = o->buf + o->len;
+    *p++ = 'e';
+    uint32_t ends[2] = { u + 1, v + 1 };
+    for (int i = 0; i < 2; i++) {
+        int len = 0;
+        uint32_t x = ends[i];
+        do {
+            tmp[len++] = (char)('0' + x % 10);
+            x /= 10;
+        } while (x);
+        *p++ = ' ';
+        while (len)
+            *p++ = tmp[--len];
+    }
+    *p++ = '\n';
+    o->len = p - o->buf;
+}
+
+static void out_flush(Out *o) {
+    size_t done = 0;
+    while (done < o->len) {
+        ssize_t w = write(o->fd, o->buf + done, o->len - done);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0) {
+            ERROR_EXIT("Error writing the graph\n%s", "");
+        }
+        done += w;
+    }
+    o->len = 0;
+}
+
+static void out_header(Out *o, const char *comment, int n, uint64_t m) {
+    char line[64];
+    out_text(o, comment, strlen(comment));
+    int len = snprintf(line, sizeof(line), "p edge %d %llu\n", n, (unsigned long long)m);
+    out_text(o, line, len);
+}
+
+static void gen_gnp(Out *o, Rng *r, int n, double p) {
+    if (p <= 0)
+        return;
+    if (p >= 1) {
+        for (uint32_t v = 1; v < (uint32_t)n; v++)
+            for (uint32_t u = 0; u < v; u++)
+                out_edge(o, u, v);
+        return;
+    }
+    double lp = log1p(-p);
+    int64_t v = 1, w = -1;
+    while (v < n) {
+        double lr = log1p(-rng_double(r));
+        w += 1 + (int64_t)floor(lr / lp);
+        while (w >= v && v < n) {
+            w -= v;
+            v++;
+        }
+        if (v < n)
+            out_edge(o, (uint32_t)w, (uint32_t)v);
+    }
+}
+
+static void gen_geometric(Out *o, const double *x, const double *y, const uint32_t *cellStart,
+                          const uint32_t *order, int n, int grid, double radius) {
+    double r2 = radius * radius;
+    /* with cells smaller than radius more than the 3x3 neighborhood has to be searched */
+    int reach = (int)ceil(radius * grid);
+    for (int i = 0; i < n; i++) {
+        int cx = (int)(x[i] * grid), cy = (int)(y[i] * grid);
+        for (int gx = cx - reach; gx <= cx + reach; gx++) {
+            if (gx < 0 || gx >= grid)
+                continue;
+            for (int gy = cy - reach; gy <= cy + reach; gy++) {
+                if (gy < 0 || gy >= grid)
+                    continue;
+                long c = (long)gx * grid + gy;
+                for (uint32_t s = cellStart[c]; s < cellStart[c + 1]; s++) {
+                    uint32_t j = order[s];
+                    if (j <= (uint32_t)i)
+                        continue;
+                    double dx = x[i] - x[j], dy = y[i] - y[j];
+                    if (dx * dx + dy * dy <= r2)
+                        out_edge(o, (uint32_t)i, j);
+                }
+            }
+        }
+    }
+}
+
+static uint64_t *gen_gnm(Rng *r, int n, uint64_t m) {
+    uint64_t allPairs = (uint64_t)n * (n - 1) / 2;
+    uint64_t *codes = malloc((m + 1) * sizeof(*codes));
+    if (codes == NULL) {
+        ERROR_EXIT("Out of memory for %llu edges\n", (unsigned long long)m);
+    }
+    /* draw with replacement, drop duplicates, and draw the missing edges again */
+    uint64_t have = 0;
+    while (have < m) {
+        for (uint64_t e = have; e < m; e++)
+            codes[e] = rng_below(r, allPairs);
+        have = sort_unique(codes, m, allPairs);
+    }
+    return codes;
+}
+
+static uint64_t *gen_leighton(Rng *r, int n, int k, uint64_t m, uint64_t *count) {
+    uint32_t *perm = malloc(n * sizeof(*perm));
+    uint32_t *classes = malloc(k * sizeof(*classes));
+    double *weight = malloc((k + 1) * sizeof(*weight));
+    uint64_t cap = m + (uint64_t)k * (k - 1) / 2 + 1;
+    uint64_t *codes = malloc(cap * sizeof(*codes));
+    uint32_t *members = malloc(k * sizeof(*members));
+    if (!perm || !classes || !weight || !codes || !members) {
+        ERROR_EXIT("Out of memory for %llu edges\n", (unsigned long long)m);
+    }
+    /* class c holds the vertices perm[c], perm[c + k], ... */
+    for (int i = 0; i < n; i++)
+        perm[i] = (uint32_t)i;
+    shuffle(r, perm, (uint32_t)n);
+    for (int c = 0; c < k; c++)
+        classes[c] = (uint32_t)c;
+    weight[0] = weight[1] = 0;
+    for (int s = 2; s <= k; s++)
+        weight[s] = weight[s - 1] + 2.0 / ((double)s * (s - 1));
+
+    uint64_t have = 0;
+    for (int c = 0; c < k; c++)
+        members[c] = perm[c]; /* the planted k-clique: the first vertex of every class */
+    int size = k;
+    for (;;) {
+        for (int a = 0; a < size && have < cap; a++) {
+            for (int b = a + 1; b < size && have < cap; b++) {
+                uint32_t u = members[a], v = members[b];
+                codes[have++] = u < v ? pair_code(u, v) : pair_code(v, u);
+            }
+        }
+        if (have >= cap || have >= m) {
+            have = sort_unique(codes, have, (uint64_t)n * (n - 1) / 2);
+            if (have >= m)
+                break;
+        }
+        /* next clique: size s by weight, s distinct classes, a random vertex in each */
+        double x = rng_double(r) * weight[k];
+        size = 2;
+        while (size < k && weight[size] <= x)
+            size++;
+        for (int i = 0; i < size; i++) {
+            uint32_t j = i + (uint32_t)rng_below(r, k - i);
+            uint32_t t = classes[i];
+            classes[i] = classes[j];
+            classes[j] = t;
+            uint32_t c = classes[i];
+            uint32_t classSize = n / k + (c < (uint32_t)(n % k));
+            members[i] = perm[c + (uint64_t)k * rng_below(r, classSize)];
+        }
+    }
+    free(perm);
+    free(classes);
+    free(weight);
+    free(members);
+    *count = have;
+    return codes;
+}
+
+static void gen_flat(Out *o, Rng *r, int n, int k, uint64_t m) {
+    uint32_t *perm = malloc(n * sizeof(*perm));
+    uint32_t *degree = calloc(n, sizeof(*degree));
+    uint32_t *first = malloc((k + 1) * sizeof(*first));
+    uint32_t *a = malloc((n / k + 1) * sizeof(*a));
+    uint32_t *b = malloc((n / k + 1) * sizeof(*b));
+    uint32_t *tmp = malloc((n / k + 1) * sizeof(*tmp));
+    uint64_t *keys = malloc((n / k + 1) * sizeof(*keys));
+    if (!perm || !degree || !first || !a || !b || !tmp || !keys) {
+        ERROR_EXIT("Out of memory\n%s", "");
+    }
+    for (int i = 0; i < n; i++)
+        perm[i] = (uint32_t)i;
+    shuffle(r, perm, (uint32_t)n);
+    /* class c is perm[first[c] .. first[c + 1]) */
+    first[0] = 0;
+    for (int c = 0; c < k; c++)
+        first[c + 1] = first[c] + n / k + (c < n % k);
+
+    /*
+     * The first n % k classes have one vertex more. Pairs of classes are filled in order of capacity (small
+     * with small, small with big, big with big), each with an even share of the edges still missing; what a
+     * full pair cannot take moves on to the larger ones, so all m edges fit.
+     */
+    uint64_t pairsLeft = (uint64_t)k * (k - 1) / 2, missing = m;
+    for (int type = 0; type <= 2; type++) {
+      for (int c = 0; c < k; c++) {
+        for (int d = c + 1; d < k; d++) {
+            if ((c < n % k) + (d < n % k) != type)
+                continue;
+            uint32_t na = first[c + 1] - first[c], nb = first[d + 1] - first[d];
+            uint64_t want = (missing + pairsLeft - 1) / pairsLeft;
+            pairsLeft--;
+            uint64_t full = (uint64_t)na * nb;
+            uint64_t take = want < full ? want : full;
+            missing -= take;
+            /*
+             * Both classes in random order, stably sorted by degree. Diagonal t pairs a[i] with b[(i + t) % nb];
+             * the full diagonals 1, 2, ... give every vertex of a the same number of edges, the partial
+             * diagonal 0 goes to the lowest degrees of both classes.
+             */
+            memcpy(a, perm + first[c], na * sizeof(*a));
+            memcpy(b, perm + first[d], nb * sizeof(*b));
+            order_by_degree(r, a, na, degree, keys, tmp);
+            order_by_degree(r, b, nb, degree, keys, tmp);
+            uint32_t fullDiagonals = (uint32_t)(take / na), rest = (uint32_t)(take % na);
+            for (uint32_t t = 0; t <= fullDiagonals; t++) {
+                uint32_t diag = t < fullDiagonals ? (t + 1) % nb : 0, len = t < fullDiagonals ? na : rest;
+                for (uint32_t i = 0; i < len; i++) {
+                    uint32_t u = a[i], v = b[(i + diag) % nb];
+                    degree[u]++;
+                    degree[v]++;
+                    out_edge(o, u, v);
+                }
+            }
+        }
+      }
+    }
+    free(perm);
+    free(degree);
+    free(first);
+    free(a);
+    free(b);
+    free(tmp);
+    free(keys);
+}
+
+static uint64_t pair_code(uint32_t u, uint32_t v) {
+    return (uint64_t)v * (v - 1) / 2 + u;
+}
+
+static void pair_decode(uint64_t code, uint32_t *u, uint32_t *v) {
+    uint64_t w = (uint64_t)((1 + sqrt(1 + 8.0 * (double)code)) / 2);
+    /* correct the rounding of the square root */
+    while (w * (w - 1) / 2 > code)
+        w--;
+    while ((w + 1) * w / 2 <= code)
+        w++;
+    *v = (uint32_t)w;
+    *u = (uint32_t)(code - w * (w - 1) / 2);
+}
+
+static uint64_t sort_unique(uint64_t *codes, uint64_t count, uint64_t limit) {
+    if (count == 0)
+        return 0;
+    int bits = 0;
+    while (bits < 64 && (limit >> bits) != 0)
+        bits++;
+    uint64_t *tmp = malloc(count * sizeof(*tmp));
+    if (tmp == NULL) {
+        ERROR_EXIT("Out of memory for sorting %llu edges\n", (unsigned long long)count);
+    }
+    static uint64_t hist[1 << 16];
+    uint64_t *src = codes, *dst = tmp;
+    for (int shift = 0; shift < bits; shift += 16) {
+        memset(hist, 0, sizeof(hist));
+        for (uint64_t i = 0; i < count; i++)
+            hist[(src[i] >> shift) & 0xffff]++;
+        uint64_t sum = 0;
+        for (int d = 0; d < (1 << 16); d++) {
+            uint64_t h = hist[d];
+            hist[d] = sum;
+            sum += h;
+        }
+        for (uint64_t i = 0; i < count; i++)
+            dst[hist[(src[i] >> shift) & 0xffff]++] = src[i];
+        uint64_t *t = src;
+        src = dst;
+        dst = t;
+    }
+    uint64_t unique = 0;
+    for (uint64_t i = 0; i < count; i++) {
+        if (i == 0 || src[i] != src[i - 1])
+            codes[unique++] = src[i];
+    }
+    free(tmp);
+    return unique;
+}
+
+static void shuffle(Rng *r, uint32_t *a, uint32_t len) {
+    for (uint32_t i = len; i > 1; i--) {
+        uint32_t j = (uint32_t)rng_below(r, i);
+        uint32_t t = a[i - 1];
+        a[i - 1] = a[j];
+        a[j] = t;
+    }
+}
+
+static void order_by_degree(Rng *r, uint32_t *a, uint32_t len, const uint32_t *degree, uint64_t *keys,
+                            uint32_t *tmp) {
+    shuffle(r, a, len);
+    for (uint32_t i = 0; i < len; i++)
+        keys[i] = (uint64_t)degree[a[i]] << 32 | i;
+    qsort(keys, len, sizeof(*keys), cmp_u64);
+    for (uint32_t i = 0; i < len; i++)
+        tmp[i] = a[keys[i] & 0xffffffffu];
+    memcpy(a, tmp, len * sizeof(*a));
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
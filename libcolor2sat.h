@@ -0,0 +1,315 @@
+/**
+ * @file libcolor2sat.h
+ * @author Michael Helm
+ * @brief Public API of libcolor2sat: load a graph and encode its k-colorability as CNF.
+ * Clauses go to a caller-supplied callback, straight into an IPASIR solver or out as DIMACS text.
+ * @date 2026-10-16
+ *
+ * Variables follow the color2sat numbering: vertex v (1-based) has color c (1..k) iff
+ * variable (v-1)*k + c is true.
+ */
+#ifndef LIBCOLOR2SAT_H
+#define LIBCOLOR2SAT_H
+
+#include "c2s_writer.h"
+
+/**
+ * Return codes of the library functions.
+ */
+enum {
+    C2S_OK = 0,
+    C2S_ERR_IO,         /* open, read or write failed, errno is set */
+    C2S_ERR_NOMEM,      /* allocation failed */
+    C2S_ERR_FORMAT,     /* missing or invalid "p edge n m" line */
+    C2S_ERR_EDGE,       /* invalid edge line, vertex out of range or more edges than announced */
+    C2S_ERR_ARG,        /* invalid argument, e.g. k <= 0 or too many variables for int literals */
+    C2S_ERR_ABORTED,    /* the clause callback asked to stop */
+    C2S_ERR_NOSOLVER,   /* no ipasir_add linked into the program */
+    C2S_ERR_MODEL,      /* the model does not decode to a proper coloring */
+    C2S_ERR_COUNT,      /* a single-pass CNF has fewer edges than its header announces and cannot be patched */
+    C2S_ERR_OVERFLOW,   /* a count does not fit: more than INT_MAX vertices or edges for an in-memory graph, or
+                           variables, clauses or bytes of the CNF beyond a long long */
+    C2S_ERR_LIMIT       /* the CNF has more variables than the limit given to the encoder */
+};
+
+/**
+ * Graph structure: number of vertices n, number of edges m,
+ * and an edge list of size m*2. Vertices are numbered from 1.
+ * declaredM is the edge count of the problem line, which may be larger than m for truncated files.
+ * ignoredLines counts the lines c2s_graph_read() skipped: comments and other lines before the problem line,
+ * and edge lines without two numbers.
+ * The counts are 64-bit, the edge list keeps 32-bit vertex numbers; graphs in memory are therefore limited to
+ * INT_MAX vertices and edges, the single-pass encoders are not.
+ */
+typedef struct {
+    long long n;
+    long long m;
+    long long declaredM;
+    int (*edges)[2];
+    long long ignoredLines;
+} C2sGraph;
+
+/**
+ * Receives one clause.
+ * @param user The pointer given to c2s_encode().
+ * @param lits The literals of the clause, without terminating 0.
+ * @param len Number of literals.
+ * @return 0 to continue, anything else to stop the encoding with C2S_ERR_ABORTED.
+ */
+typedef int (*C2sClauseFn)(void *user, const int *lits, int len);
+
+/**
+ * Phases of c2s_encode_dimacs_observed(), in this order.
+ */
+enum {
+    C2S_PHASE_ALO = 0,  /* header and at-least-one-color clauses */
+    C2S_PHASE_AMO,      /* at-most-one-color clauses */
+    C2S_PHASE_EDGES,    /* edge clauses */
+    C2S_PHASE_FLUSH,    /* flushing the last buffers and waiting for the writes */
+    C2S_PHASE_DONE      /* reported once after the output is complete */
+};
+
+/**
+ * Encoding variants, combined with |; C2S_ENC_NO_AMO and C2S_ENC_SEQ_AMO exclude each other.
+ * Every variant keeps the color variables 1..n*k, so c2s_decode() works for all of them.
+ */
+enum {
+    C2S_ENC_DIRECT = 0,         /* at-least-one, pairwise at-most-one and edge clauses */
+    C2S_ENC_NO_AMO = 1 << 0,    /* no at-most-one clauses: a vertex may get several colors, each of them fits */
+    C2S_ENC_SEQ_AMO = 1 << 1,   /* sequential counter at-most-one (Sinz 2005): 3k-4 clauses and k-1 auxiliary
+                                   variables per vertex, numbered after the color variables */
+    C2S_ENC_SYMMETRY = 1 << 2,  /* unit clauses restricting vertex v < k to the colors 1..v, after the edges */
+    C2S_ENC_COUNT = 1 << 3      /* bound of the combinations; those with both AMO flags are invalid */
+};
+
+/**
+ * Observes the DIMACS encoding.
+ * @param user The pointer given to c2s_encode_dimacs_observed().
+ * @param phase The phase starting now, see C2S_PHASE_*.
+ * @param bytes Bytes of CNF text produced before this phase began.
+ */
+typedef void (*C2sPhaseFn)(void *user, int phase, unsigned long long bytes);
+
+/**
+ * Read DIMACS .col graph from a file.
+ * DIMACS Format has to match the format described here https://mat.tepper.cmu.edu/COLOR/instances.html
+ * @param file The name of the input file, "-" for stdin.
+ * @param out Receives the allocated graph, free it with c2s_graph_free().
+ * @param line Receives the number of the offending line on C2S_ERR_FORMAT and C2S_ERR_EDGE. May be NULL.
+ * @return C2S_OK or an error code; C2S_ERR_OVERFLOW if the problem line announces more than INT_MAX vertices
+ * or edges.
+ */
+int c2s_graph_read(const char *file, C2sGraph **out, long long *line);
+
+/**
+ * Build a graph from an edge list.
+ * @param n Number of vertices.
+ * @param m Number of edges.
+ * @param edges 2*m vertex numbers (1-based), edge e is {edges[2e], edges[2e+1]}. Copied.
+ * @param out Receives the allocated graph.
+ * @return C2S_OK, C2S_ERR_ARG or C2S_ERR_NOMEM.
+ */
+int c2s_graph_from_edges(int n, int m, const int *edges, C2sGraph **out);
+
+/**
+ * Build a graph from CSR adjacency arrays with 0-based vertices.
+ * Only entries v > u of row u are used, so symmetric and upper-triangular CSR give the same graph.
+ * @param n Number of vertices.
+ * @param offsets n+1 row offsets into adj.
+ * @param adj Neighbour indices.
+ * @param out Receives the allocated graph.
+ * @return C2S_OK, C2S_ERR_ARG or C2S_ERR_NOMEM.
+ */
+int c2s_graph_from_csr(int n, const int *offsets, const int *adj, C2sGraph **out);
+
+/**
+ * Free a graph and its resources.
+ */
+void c2s_graph_free(C2sGraph *g);
+
+/**
+ * The counting functions return -1 if the count does not fit a long long.
+ * @return Number of variables n*k.
+ */
+long long c2s_num_vars(const C2sGraph *g, long k);
+
+/**
+ * @return Number of clauses n + n*k*(k-1)/2 + m*k, or -1.
+ */
+long long c2s_num_clauses(const C2sGraph *g, long k);
+
+/**
+ * @return Number of variables of an encoding variant, see C2S_ENC_*, or -1.
+ */
+long long c2s_encoding_vars(const C2sGraph *g, long k, int encoding);
+
+/**
+ * @return Number of clauses of an encoding variant, or -1.
+ */
+long long c2s_encoding_clauses(const C2sGraph *g, long k, int encoding);
+
+/**
+ * @param phase C2S_PHASE_ALO, C2S_PHASE_AMO or C2S_PHASE_EDGES; the symmetry breaking units count to the edges.
+ * @return Number of clauses an encoding variant emits in that phase, 0 for other phases, or -1.
+ */
+long long c2s_phase_clauses(const C2sGraph *g, long k, int encoding, int phase);
+
+/**
+ * Check that the CNF of an encoding variant can be written: its variables, clauses and an upper bound of its
+ * bytes fit a long long, and the variables stay within maxVars. Only n and m of g are used.
+ * @param maxVars Largest variable the consumer accepts, e.g. INT_MAX for solvers with int literals; 0 for none.
+ * @return C2S_OK, C2S_ERR_ARG for an invalid k or variant, C2S_ERR_OVERFLOW or C2S_ERR_LIMIT.
+ */
+int c2s_encoding_check(const C2sGraph *g, long k, int encoding, long long maxVars);
+
+/**
+ * Exact size of the DIMACS text c2s_encode_dimacs_observed() writes, from the digit counts of the variables.
+ * Nothing is formatted; the edge list is scanned once.
+ * @param phaseBytes Receives the bytes of C2S_PHASE_ALO (with the header), C2S_PHASE_AMO and C2S_PHASE_EDGES
+ * (with the symmetry breaking units). May be NULL.
+ * @return Bytes of the whole CNF, or -1 for an invalid k or variant or if a count overflows.
+ */
+long long c2s_encoding_bytes(const C2sGraph *g, long k, int encoding, long long *phaseBytes);
+
+/**
+ * c2s_encoding_bytes() of every encoding variant of a .col file, read in a single pass that keeps no edges:
+ * the digits of the conflict clauses are summed per edge as it is parsed, so memory does not grow with n or
+ * m and graphs beyond INT_MAX vertices or edges can be sized. The sizes are those of the output of
+ * c2s_encode_dimacs_stream(), counting the edges actually read.
+ * @param file The input graph, "-" for stdin.
+ * @param bytes Receives the bytes of variant e in bytes[e], -1 for an invalid variant or if a count overflows.
+ * @param shape Receives n, the number of edges read, the declared edge count and the ignored lines; edges
+ * is NULL. May be NULL.
+ * @param line Receives the number of the offending line on C2S_ERR_FORMAT and C2S_ERR_EDGE. May be NULL.
+ * @return C2S_OK, C2S_ERR_ARG for an invalid k, C2S_ERR_NOMEM, C2S_ERR_FORMAT, C2S_ERR_EDGE or C2S_ERR_IO
+ * (shape->n is 0 if the graph could not be opened).
+ */
+int c2s_encoding_bytes_stream(const char *file, long k, long long bytes[C2S_ENC_COUNT], C2sGraph *shape,
+                              long long *line);
+
+/**
+ * @return A static name of an encoding variant, e.g. "seq-amo+sym", or NULL if the combination is invalid.
+ */
+const char *c2s_encoding_name(int encoding);
+
+/**
+ * @return The encoding variant with the name given by c2s_encoding_name(), or -1.
+ */
+int c2s_encoding_parse(const char *name);
+
+/**
+ * Push every clause of the k-colorability encoding to fn, in the same order as the DIMACS output.
+ * @return C2S_OK, C2S_ERR_ARG if n*k does not fit an int literal, or C2S_ERR_ABORTED.
+ */
+int c2s_encode(const C2sGraph *g, int k, C2sClauseFn fn, void *user);
+
+/**
+ * Like c2s_encode() for an encoding variant.
+ * @return C2S_OK, C2S_ERR_ARG for an invalid variant or too many variables, or C2S_ERR_ABORTED.
+ */
+int c2s_encode_variant(const C2sGraph *g, int k, int encoding, C2sClauseFn fn, void *user);
+
+/**
+ * Add every clause to an IPASIR solver with ipasir_add(). The solver library has to be linked into the
+ * program; ipasir_add is a weak reference, so programs without one still link.
+ * @return C2S_OK, C2S_ERR_ARG or C2S_ERR_NOSOLVER.
+ */
+int c2s_encode_ipasir(const C2sGraph *g, int k, void *solver);
+
+/**
+ * Write the encoding as DIMACS CNF text to fd. The descriptor is not closed.
+ * @param mode Output backend, see c2s_writer.h.
+ * @return C2S_OK, C2S_ERR_ARG, C2S_ERR_OVERFLOW, C2S_ERR_NOMEM or C2S_ERR_IO.
+ */
+int c2s_encode_dimacs(const C2sGraph *g, long k, int fd, C2sIoMode mode);
+
+/**
+ * Like c2s_encode_dimacs() for an encoding variant, reporting the start of every phase to fn, e.g. for
+ * timing. fn is called from the encoding thread; without fn the encoding does no extra work.
+ * @param encoding Encoding variant, see C2S_ENC_*.
+ * @param fn Phase observer or NULL.
+ * @param user Passed to fn.
+ * @return See c2s_encode_dimacs().
+ */
+int c2s_encode_dimacs_observed(const C2sGraph *g, long k, int encoding, int fd, C2sIoMode mode, C2sPhaseFn fn,
+                               void *user);
+
+/**
+ * Single-pass encoding of a .col file: blocks 1 and 2 are written as soon as the problem line is read, and
+ * every edge is turned into its conflict clauses right after it is parsed. Only one batch of edges is held in
+ * memory, so the memory use does not depend on the number of edges. The header counts come from the problem
+ * line; if the file has fewer edges and fd is a regular file, the header is rewritten in place at the end,
+ * padded with spaces to its old length. The output equals that of c2s_graph_read() and
+ * c2s_encode_dimacs_observed() whenever the edge count matches. Parsing happens during C2S_PHASE_EDGES.
+ * Vertex numbers and counts are 64-bit; edges are parsed into 32-bit pairs while n fits an int and into
+ * 64-bit pairs beyond, so graphs with more than INT_MAX vertices or edges can be encoded.
+ * @param file The input graph, "-" for stdin.
+ * @param maxVars Largest variable the consumer accepts, 0 for none. Checked with c2s_encoding_check() against
+ * the problem line before anything is written.
+ * @param shape Receives n, the number of edges read, the declared edge count and the ignored lines; edges
+ * is NULL. May be NULL.
+ * @param line Receives the number of the offending line on C2S_ERR_FORMAT and C2S_ERR_EDGE. May be NULL.
+ * @return C2S_OK, C2S_ERR_ARG, C2S_ERR_OVERFLOW, C2S_ERR_LIMIT, C2S_ERR_NOMEM, C2S_ERR_FORMAT, C2S_ERR_EDGE,
+ * C2S_ERR_IO (shape->n is 0 if the graph could not be opened), or C2S_ERR_COUNT if fewer edges were read and
+ * the header could not be patched.
+ */
+int c2s_encode_dimacs_stream(const char *file, long k, int encoding, long long maxVars, int fd, C2sIoMode mode,
+                             C2sPhaseFn fn, void *user, C2sGraph *shape, long long *line);
+
+/**
+ * Like c2s_encode_dimacs_stream(), with the parsing on a reader thread. The thread hands batches of edges to
+ * the encoder through a lock-free single-producer/single-consumer ring, so reading the input overlaps with
+ * writing blocks 1 and 2 and with formatting earlier edges. The reader may run up to 1024 batches of 4096
+ * edges (32 MiB, 64 MiB with 64-bit vertex numbers) ahead. The output is the same as that of
+ * c2s_encode_dimacs_stream().
+ */
+int c2s_encode_dimacs_pipelined(const char *file, long k, int encoding, long long maxVars, int fd, C2sIoMode mode,
+                                C2sPhaseFn fn, void *user, C2sGraph *shape, long long *line);
+
+/**
+ * Memory budget and spill directory of c2s_encode_dimacs_sorted(), and what the sort did.
+ */
+typedef struct {
+    size_t memBudget;       /* bytes for the sorted runs and the merge, at least 4 MiB */
+    const char *tmpDir;     /* directory of the spilled runs, NULL for $TMPDIR or /tmp */
+    long long edgesRead;    /* filled in: edge lines read, repeats included */
+    int runs;               /* filled in: sorted runs spilled to tmpDir, 0 if the edges fit memBudget */
+    int mergePasses;        /* filled in: merge passes that wrote the runs back before the final merge */
+} C2sSortOptions;
+
+/**
+ * Single-pass encoding of a .col file whose edge list need not fit into memory. The edges are read first,
+ * each as {min(u,v), max(u,v)}, and sorted into runs of memBudget/16 edges that go to tmpDir once the budget
+ * is full; a k-way merge of the runs drops every repeated edge and feeds the edge block, which comes out sorted
+ * by (u, v) and free of duplicates. On a regular file the header takes the edges of all runs and is patched
+ * like that of c2s_encode_dimacs_stream(); other outputs get the exact edge count from a counting merge. The other blocks are those of c2s_encode_dimacs_stream(). Reading and sorting happen before
+ * C2S_PHASE_ALO. Vertex numbers are limited to 32 bits.
+ * @param sort Budget and directory; receives the statistics.
+ * @param shape Receives n, the number of distinct edges, the declared edge count and the ignored lines.
+ * @return See c2s_encode_dimacs_stream(); C2S_ERR_OVERFLOW also for more than 4294967295 vertices, and
+ * C2S_ERR_IO if a run cannot be spilled or read back.
+ */
+int c2s_encode_dimacs_sorted(const char *file, long k, int encoding, long long maxVars, int fd, C2sIoMode mode,
+                             C2sPhaseFn fn, void *user, C2sGraph *shape, long long *line, C2sSortOptions *sort);
+
+/**
+ * @return A static name of a C2S_PHASE_* value, e.g. "amo".
+ */
+const char *c2s_phase_name(int phase);
+
+/**
+ * Decode a model into a coloring and check it.
+ * @param model Literals of the model in any order, like the "v" lines of a solver; literals of variables
+ * outside 1..n*k are ignored. A vertex with several true colors gets the smallest.
+ * @param nlits Number of literals in model.
+ * @param colors Receives the color (1..k) of vertex v in colors[v-1].
+ * @return C2S_OK, or C2S_ERR_MODEL if a vertex has no color or two adjacent vertices share one.
+ */
+int c2s_decode(const C2sGraph *g, long k, const int *model, long long nlits, int *colors);
+
+/**
+ * @return A static description of a return code.
+ */
+const char *c2s_strerror(int code);
+
+#endif /* LIBCOLOR2SAT_H */
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Machine-readable phase records of combined_script.py: one JSON object per line, appended to the file given
+with --jsonl. color2sat --jsonl writes its own parse/emit record to the same file; both carry the run id
+from the C2S_RUN_ID environment variable, so the records of one run can be joined.
+
+With --trace, the same phases and every solver process also become spans in the Chrome trace event format,
+in a file shared with color2sat --trace.
+"""
+import json
+import os
+import resource
+import threading
+import time
+
+RUN_ID_ENV = 'C2S_RUN_ID'
+
+VERDICTS = {10: 'SAT', 20: 'UNSAT'}
+
+
+def wait4(proc):
+    """Wait for a Popen child with os.wait4, set its returncode and return its rusage."""
+    _, status, usage = os.wait4(proc.pid, 0)
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    return usage
+
+
+def usage_fields(usage):
+    """CPU seconds and peak RSS of a wait4 rusage."""
+    return {'cpu_s': round(usage.ru_utime + usage.ru_stime, 3), 'maxrss_kb': usage.ru_maxrss}
+
+
+class Timer:
+    """Wall clock and CPU time (this process and its waited-for children) since creation."""
+
+    def __init__(self):
+        self.start = time.monotonic()
+        self.cpu = self._cpu()
+
+    @staticmethod
+    def _cpu():
+        own = resource.getrusage(resource.RUSAGE_SELF)
+        children = resource.getrusage(resource.RUSAGE_CHILDREN)
+        return own.ru_utime + own.ru_stime + children.ru_utime + children.ru_stime
+
+    def fields(self, usage=None):
+        """wall_s and cpu_s so far; with a wait4 rusage, cpu_s and maxrss_kb of that child instead."""
+        fields = {'wall_s': round(time.monotonic() - self.start, 6), 'cpu_s': round(self._cpu() - self.cpu, 3)}
+        if usage is not None:
+            fields.update(usage_fields(usage))
+        return fields
+
+
+class PhaseLog:
+    """Appends records to path; without a path every call is a no-op."""
+
+    def __init__(self, path, **context):
+        self.path = path
+        self.context = context
+        if path:
+            self.run = os.environ.setdefault(RUN_ID_ENV, f"{os.uname().nodename}-{os.getpid()}-{time.time_ns()}")
+
+    def __bool__(self):
+        return bool(self.path)
+
+    def record(self, phase, timer=None, usage=None, **fields):
+        """
+        Append {run, tool, pid, <context>, phase, <fields>} as one line, in a single write.
+        With a timer, the phase also goes into the trace and its times into the record (see Timer.fields).
+        """
+        if timer is not None:
+            fields = {**timer.fields(usage), **fields}
+            trace.span(phase, timer.start, **fields)
+        if not self.path:
+            return
+        rec = {'run': self.run, 'tool': 'combined_script', 'pid': os.getpid(), **self.context, 'phase': phase,
+               **fields}
+        line = (json.dumps(rec, separators=(',', ':')) + '\n').encode()
+        fd = os.open(self.path, os.O_WRONLY | os.O_CREAT | os.O_APPEND, 0o666)
+        try:
+            os.write(fd, line)
+        finally:
+            os.close(fd)
+
+
+class Trace:
+    """
+    Chrome trace events of this process and of the solver processes it starts. The events are collected in
+    memory and appended by flush() the way c2s_trace.c does it: the file is in the JSON array format without
+    the closing bracket, created atomically with the opening one, so several processes can share it.
+    Timestamps are time.monotonic() microseconds, the CLOCK_MONOTONIC that color2sat uses as well.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.events = []
+        self.named = set()
+        self.lock = threading.Lock()
+
+    def __bool__(self):
+        return bool(self.path)
+
+    def span(self, name, start, end=None, pid=None, process=None, **args):
+        """
+        Add a complete event from start to end (default: now) in time.monotonic() seconds.
+        @param pid Process track of the span, default this process; process names that track once.
+        """
+        if not self.path:
+            return
+        end = time.monotonic() if end is None else end
+        own = pid is None
+        pid = os.getpid() if own else pid
+        with self.lock:
+            if pid not in self.named:
+                self.named.add(pid)
+                self.events.append({'name': 'process_name', 'ph': 'M', 'pid': pid, 'tid': pid,
+                                    'args': {'name': process or 'combined_script'}})
+            self.events.append({'name': name, 'cat': 'combined_script', 'ph': 'X', 'pid': pid,
+                                'tid': threading.get_native_id() if own else pid, 'ts': round(start * 1e6, 3),
+                                'dur': round((end - start) * 1e6, 3), 'args': args})
+
+    def flush(self):
+        """Append the collected events to the file."""
+        with self.lock:
+            events, self.events = self.events, []
+        if not self.path or not events:
+            return
+        data = ''.join(json.dumps(e, separators=(',', ':')) + ',\n' for e in events).encode()
+        tmp = f"{self.path}.{os.getpid()}.tmp"
+        try:
+            with open(tmp, 'xb') as f:
+                f.write(b'[\n' + data)
+            os.link(tmp, self.path)
+            return
+        except FileExistsError:
+            pass
+        finally:
+            if os.path.exists(tmp):
+                os.unlink(tmp)
+        fd = os.open(self.path, os.O_WRONLY | os.O_APPEND)
+        try:
+            os.write(fd, data)
+        finally:
+            os.close(fd)
+
+
+# the trace of this process, replaced by combined_script.py --trace
+trace = Trace(None)
@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+"""
+ctypes bindings for libcolor2sat.so: load graphs, encode them to DIMACS CNF in memory or into a file
+descriptor, and decode solver models into colorings, all without starting a color2sat process.
+Build the shared library with `make lib`. Set C2S_LIB to use a library outside this directory.
+"""
+import ctypes
+import os
+
+C2S_OK = 0
+C2S_ERR_MODEL = 8
+
+IO_MODES = {'auto': 0, 'uring': 1, 'thread': 2, 'sync': 3}
+
+# names of the C2S_ENC_* variants, as c2s_encoding_name() returns them
+ENCODINGS = ('direct', 'no-amo', 'seq-amo', 'direct+sym', 'no-amo+sym', 'seq-amo+sym')
+
+
+class _C2sGraph(ctypes.Structure):
+    _fields_ = [
+        ('n', ctypes.c_longlong),
+        ('m', ctypes.c_longlong),
+        ('declaredM', ctypes.c_longlong),
+        ('edges', ctypes.POINTER(ctypes.c_int)),
+        ('ignoredLines', ctypes.c_longlong),
+    ]
+
+
+_GraphPtr = ctypes.POINTER(_C2sGraph)
+_lib = None
+
+
+class Color2SatError(Exception):
+    """A libcolor2sat call returned an error code."""
+
+    def __init__(self, code, what):
+        self.code = code
+        super().__init__(f"{what}: {_lib.c2s_strerror(code).decode()}")
+
+
+def load_library(path=None):
+    """Load libcolor2sat.so once and declare the function signatures. Returns the ctypes library."""
+    global _lib
+    if _lib is not None:
+        return _lib
+    if path is None:
+        path = os.environ.get('C2S_LIB') or os.path.join(
+            os.path.dirname(os.path.abspath(__file__)), 'libcolor2sat.so')
+    lib = ctypes.CDLL(path)
+
+    lib.c2s_graph_read.argtypes = [ctypes.c_char_p, ctypes.POINTER(_GraphPtr), ctypes.POINTER(ctypes.c_longlong)]
+    lib.c2s_graph_from_edges.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.POINTER(ctypes.c_int),
+                                         ctypes.POINTER(_GraphPtr)]
+    lib.c2s_graph_free.argtypes = [_GraphPtr]
+    lib.c2s_graph_free.restype = None
+    lib.c2s_num_vars.argtypes = [_GraphPtr, ctypes.c_long]
+    lib.c2s_num_vars.restype = ctypes.c_longlong
+    lib.c2s_num_clauses.argtypes = [_GraphPtr, ctypes.c_long]
+    lib.c2s_num_clauses.restype = ctypes.c_longlong
+    lib.c2s_encode_dimacs.argtypes = [_GraphPtr, ctypes.c_long, ctypes.c_int, ctypes.c_int]
+    lib.c2s_encode_dimacs_observed.argtypes = [_GraphPtr, ctypes.c_long, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                               ctypes.c_void_p, ctypes.c_void_p]
+    lib.c2s_encoding_vars.argtypes = [_GraphPtr, ctypes.c_long, ctypes.c_int]
+    lib.c2s_encoding_vars.restype = ctypes.c_longlong
+    lib.c2s_encoding_clauses.argtypes = [_GraphPtr, ctypes.c_long, ctypes.c_int]
+    lib.c2s_encoding_clauses.restype = ctypes.c_longlong
+    lib.c2s_encoding_bytes.argtypes = [_GraphPtr, ctypes.c_long, ctypes.c_int, ctypes.c_void_p]
+    lib.c2s_encoding_bytes.restype = ctypes.c_longlong
+    lib.c2s_encoding_parse.argtypes = [ctypes.c_char_p]
+    lib.c2s_decode.argtypes = [_GraphPtr, ctypes.c_long, ctypes.POINTER(ctypes.c_int), ctypes.c_longlong,
+                               ctypes.POINTER(ctypes.c_int)]
+    lib.c2s_strerror.argtypes = [ctypes.c_int]
+    lib.c2s_strerror.restype = ctypes.c_char_p
+    _lib = lib
+    return lib
+
+
+def available():
+    """True if libcolor2sat.so can be loaded."""
+    try:
+        load_library()
+        return True
+    except OSError:
+        return False
+
+
+def encoding_code(name):
+    """The C2S_ENC_* value of an encoding name like 'seq-amo+sym' (see color2sat --encoding)."""
+    code = load_library().c2s_encoding_parse(name.encode())
+    if code < 0:
+        raise ValueError(f"unknown encoding '{name}'")
+    return code
+
+
+class Graph:
+    """A graph held by libcolor2sat. Vertices are numbered from 1."""
+
+    def __init__(self, ptr):
+        self._ptr = ptr
+
+    @classmethod
+    def from_file(cls, path):
+        """Read a DIMACS .col file ('-' for stdin)."""
+        lib = load_library()
+        ptr = _GraphPtr()
+        line = ctypes.c_longlong(0)
+        rc = lib.c2s_graph_read(os.fsencode(path), ctypes.byref(ptr), ctypes.byref(line))
+        if rc != C2S_OK:
+            raise Color2SatError(rc, f"{path}: line {line.value}")
+        return cls(ptr)
+
+    @classmethod
+    def from_edges(cls, n, edges):
+        """Build a graph from n and an iterable of (u, v) pairs."""
+        lib = load_library()
+        flat = [x for e in edges for x in e]
+        arr = (ctypes.c_int * max(len(flat), 1))(*flat)
+        ptr = _GraphPtr()
+        rc = lib.c2s_graph_from_edges(n, len(flat) // 2, arr, ctypes.byref(ptr))
+        if rc != C2S_OK:
+            raise Color2SatError(rc, "from_edges")
+        return cls(ptr)
+
+    @property
+    def n(self):
+        return self._ptr.contents.n
+
+    @property
+    def m(self):
+        return self._ptr.contents.m
+
+    def num_vars(self, k, encoding='direct'):
+        return _lib.c2s_encoding_vars(self._ptr, k, encoding_code(encoding))
+
+    def num_clauses(self, k, encoding='direct'):
+        return _lib.c2s_encoding_clauses(self._ptr, k, encoding_code(encoding))
+
+    def cnf_size(self, k, encoding='direct'):
+        """Exact size in bytes of the DIMACS CNF for k colors, computed without encoding."""
+        return _lib.c2s_encoding_bytes(self._ptr, k, encoding_code(encoding), None)
+
+    def encode_to_fd(self, k, fd, io='sync', encoding='direct'):
+        """Write the DIMACS CNF for k colors to an open file descriptor (not closed)."""
+        rc = _lib.c2s_encode_dimacs_observed(self._ptr, k, encoding_code(encoding), fd, IO_MODES[io], None, None)
+        if rc != C2S_OK:
+            raise Color2SatError(rc, "encode")
+
+    def encode(self, k):
+        """Return the DIMACS CNF for k colors as bytes, encoded through an anonymous memory file."""
+        fd = os.memfd_create('color2sat-cnf')
+        try:
+            self.encode_to_fd(k, fd)
+            size = os.lseek(fd, 0, os.SEEK_END)
+            return os.pread(fd, size, 0)
+        finally:
+            os.close(fd)
+
+    def decode(self, k, model):
+        """
+        Turn a model (iterable of literals, e.g. from the 'v' lines of a solver) into a list of colors,
+        colors[v-1] for vertex v. Raises Color2SatError if it is not a proper coloring.
+        """
+        lits = list(model)
+        arr = (ctypes.c_int * max(len(lits), 1))(*lits)
+        colors = (ctypes.c_int * self.n)()
+        rc = _lib.c2s_decode(self._ptr, k, arr, len(lits), colors)
+        if rc != C2S_OK:
+            raise Color2SatError(rc, "decode")
+        return list(colors)
+
+    def close(self):
+        if self._ptr:
+            _lib.c2s_graph_free(self._ptr)
+            self._ptr = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+
+    def __del__(self):
+        if _lib is not None:
+            self.close()
+
+
+def parse_model(text):
+    """Collect the literals of all 'v' lines of a solver output."""
+    lits = []
+    for line in text.splitlines():
+        if line.startswith('v '):
+            lits.extend(int(x) for x in line[2:].split() if x != '0')
+    return lits
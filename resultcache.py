@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""
+Persistent store of solver results for combined_script.py: an append-only JSONL log with one record per
+solved (graph, k) and a small JSON index next to it. Records are keyed by a canonical hash of the edge set,
+k, the encoding options and the solver identity. Lookups answer monotonically: a stored k-coloring also
+answers every larger k, and a stored UNSAT at k answers every smaller k.
+"""
+import fcntl
+import hashlib
+import json
+import os
+import subprocess
+import time
+
+ENCODING = 'direct'  # default encoding of color2sat; other variants are keyed by their --encoding name
+
+
+def graph_hash(path):
+    """
+    SHA-256 of the canonical edge set of a DIMACS .col file: the vertex count and the sorted, deduplicated
+    list of edges with the smaller endpoint first. Edge order, direction, duplicates and comments do not
+    change the hash.
+    @return (hex digest, n)
+    """
+    n = 0
+    edges = set()
+    with open(path) as f:
+        for line in f:
+            if line.startswith('p'):
+                n = int(line.split()[2])
+            elif line.startswith('e'):
+                u, v = map(int, line.split()[1:3])
+                if u != v:
+                    edges.add((u, v) if u < v else (v, u))
+    h = hashlib.sha256(f"{n}\n".encode())
+    for u, v in sorted(edges):
+        h.update(f"{u} {v}\n".encode())
+    return h.hexdigest(), n
+
+
+_identities = {}
+
+
+def solver_identity(path):
+    """
+    Identity of a solver binary: the reported version for kissat, a hash of the binary otherwise.
+    Cached per path and modification time.
+    """
+    try:
+        st = os.stat(path)
+    except OSError:
+        return os.path.basename(path)
+    key = (path, st.st_mtime_ns)
+    if key not in _identities:
+        ident = None
+        if 'kissat' in os.path.basename(path):
+            try:
+                out = subprocess.run([path, '--version'], capture_output=True, text=True, timeout=10).stdout
+                if out.strip():
+                    ident = 'kissat-' + out.split()[0]
+            except (OSError, subprocess.TimeoutExpired):
+                pass
+        if ident is None:
+            with open(path, 'rb') as f:
+                ident = os.path.basename(path) + '-' + hashlib.sha256(f.read()).hexdigest()[:12]
+        _identities[key] = ident
+    return _identities[key]
+
+
+def colors_from_model(model, n, k):
+    """Colors 1..k of the vertices 1..n from the literals of a model (smallest true color per vertex)."""
+    colors = [0] * n
+    for lit in model:
+        if 0 < lit <= n * k:
+            v, c = divmod(lit - 1, k)
+            if colors[v] == 0 or c + 1 < colors[v]:
+                colors[v] = c + 1
+    return colors if all(colors) else None
+
+
+def model_from_colors(colors, k):
+    """A model of the k-coloring CNF that assigns every vertex its color."""
+    return [(v * k + c) if c == colors[v] else -(v * k + c)
+            for v in range(len(colors)) for c in range(1, k + 1)]
+
+
+class ResultCache:
+    """
+    The log <path>.log holds one JSON record per line. The index <path>.idx maps each group
+    "<graph hash>/<encoding>/<solver>" to the byte offsets of its smallest SAT k and largest UNSAT k, and
+    records how much of the log it covers; a stale or missing index is brought up to date from the log.
+    Writers serialize on an flock of the log, so parallel batch jobs can share one cache.
+    """
+
+    def __init__(self, path):
+        self.log_path = path + '.log'
+        self.idx_path = path + '.idx'
+
+    @staticmethod
+    def group(ghash, encoding, solver):
+        return f"{ghash}/{encoding}/{solver}"
+
+    def _load_index(self, log):
+        """Read the index and add the records appended after it was written."""
+        index = {'covered': 0, 'groups': {}}
+        try:
+            with open(self.idx_path) as f:
+                index = json.load(f)
+        except (OSError, ValueError):
+            pass
+        size = os.fstat(log.fileno()).st_size
+        if index['covered'] > size:  # the log was replaced
+            index = {'covered': 0, 'groups': {}}
+        if index['covered'] < size:
+            log.seek(index['covered'])
+            offset = index['covered']
+            for line in log:
+                try:
+                    self._index_record(index, json.loads(line), offset)
+                except (ValueError, KeyError):
+                    pass  # a record cut off by a crash
+                offset += len(line.encode())
+            index['covered'] = offset
+        return index
+
+    @staticmethod
+    def _index_record(index, rec, offset):
+        entry = index['groups'].setdefault(ResultCache.group(rec['graph'], rec['encoding'], rec['solver']), {})
+        if rec['verdict'] == 'SAT' and ('sat' not in entry or rec['k'] < entry['sat'][0]):
+            entry['sat'] = [rec['k'], offset]
+        elif rec['verdict'] == 'UNSAT' and ('unsat' not in entry or rec['k'] > entry['unsat'][0]):
+            entry['unsat'] = [rec['k'], offset]
+
+    def _save_index(self, index):
+        tmp = self.idx_path + '.tmp'
+        with open(tmp, 'w') as f:
+            json.dump(index, f)
+        os.replace(tmp, self.idx_path)
+
+    def lookup(self, ghash, k, encoding, solver):
+        """
+        @return The stored record that decides k (a SAT record with k_stored <= k or an UNSAT record with
+        k_stored >= k), or None.
+        """
+        if not os.path.exists(self.log_path):
+            return None
+        with open(self.log_path, 'r') as log:
+            fcntl.flock(log, fcntl.LOCK_SH)
+            index = self._load_index(log)
+            entry = index['groups'].get(self.group(ghash, encoding, solver), {})
+            for verdict, hit in (('sat', lambda kk: kk <= k), ('unsat', lambda kk: kk >= k)):
+                if verdict in entry and hit(entry[verdict][0]):
+                    log.seek(entry[verdict][1])
+                    return json.loads(log.readline())
+        return None
+
+    def store(self, ghash, k, encoding, solver, verdict, colors, timings):
+        """Append a record and update the index."""
+        rec = {'graph': ghash, 'k': k, 'encoding': encoding, 'solver': solver, 'verdict': verdict,
+               'colors': colors, 'timings': timings, 'time': int(time.time())}
+        with open(self.log_path, 'a+') as log:
+            fcntl.flock(log, fcntl.LOCK_EX)
+            index = self._load_index(log)
+            offset = os.fstat(log.fileno()).st_size
+            line = json.dumps(rec, separators=(',', ':')) + '\n'
+            if offset > 0 and os.pread(log.fileno(), 1, offset - 1) != b'\n':
+                line = '\n' + line  # terminate a record cut off by a crash
+                offset += 1
+            log.write(line)
+            log.flush()
+            os.fsync(log.fileno())
+            self._index_record(index, rec, offset)
+            index['covered'] = os.fstat(log.fileno()).st_size
+            self._save_index(index)
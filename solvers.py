@@ -0,0 +1,343 @@
+#!/usr/bin/env python3
+"""
+Solver invocation for the wrapper scripts: the shipped kissat, minisat v1.14 and SatELite v1.0 binaries,
+and a portfolio that races several solver configurations on one CNF until the first definitive answer.
+Every result is normalized to the kissat output format ("s ..." and "v ... 0" lines).
+"""
+import os
+import signal
+import subprocess
+import tempfile
+import time
+
+import phaselog
+from pycolor2sat import parse_model
+
+SAT = 10
+UNSAT = 20
+UNKNOWN = 0
+
+STATUS_LINES = {SAT: 's SATISFIABLE', UNSAT: 's UNSATISFIABLE'}
+
+
+class SolverPaths:
+    """Locations of the solver binaries."""
+
+    def __init__(self, kissat='./kissat', minisat='./binary_minisat/minisat_v1.14',
+                 satelite='./binary_minisat/SatELite_v1.0_linux'):
+        self.kissat = kissat
+        self.minisat = minisat
+        self.satelite = satelite
+
+
+class Member:
+    """
+    One portfolio member: a solver kind ('kissat', 'minisat' or 'satelite', the latter meaning SatELite
+    preprocessing followed by minisat) and extra command line options.
+    """
+
+    def __init__(self, name, kind, options=()):
+        self.name = name
+        self.kind = kind
+        self.options = list(options)
+
+
+# Largest variable each solver reads, like the color2sat --max-vars presets of the same name: kissat rejects
+# larger problem lines, minisat stores a literal as 2*var+sign in an int. SatELite is built on minisat.
+MAX_VARS = {'kissat': (1 << 30) - 1, 'minisat': (1 << 30) - 1}
+LIMIT_OF_KIND = {'kissat': 'kissat', 'minisat': 'minisat', 'satelite': 'minisat'}
+
+
+def max_vars_target(kinds):
+    """
+    The color2sat --max-vars preset for a run of the given solver kinds: the one with the lowest limit, so
+    every solver of the run can read the CNF.
+    """
+    return min(sorted({LIMIT_OF_KIND[k] for k in kinds}, reverse=True), key=MAX_VARS.get)
+
+
+DEFAULT_PORTFOLIO = [
+    Member('kissat', 'kissat'),
+    Member('kissat-sat', 'kissat', ['--sat', '--seed=1']),
+    Member('kissat-unsat', 'kissat', ['--unsat', '--seed=2']),
+    Member('minisat', 'minisat'),
+    Member('satelite+minisat', 'satelite'),
+]
+
+
+def select_members(names):
+    """Pick portfolio members by a comma separated list of names, or all of them for None."""
+    if not names:
+        return list(DEFAULT_PORTFOLIO)
+    by_name = {m.name: m for m in DEFAULT_PORTFOLIO}
+    unknown = [n for n in names.split(',') if n not in by_name]
+    if unknown:
+        raise ValueError(f"unknown portfolio member(s) {', '.join(unknown)} "
+                         f"(known: {', '.join(by_name)})")
+    return [by_name[n] for n in names.split(',')]
+
+
+def member_command(member, paths, cnf, workdir):
+    """
+    Build the command line of a member. A cnf of None makes the member read the CNF from stdin.
+    @return (argv, result_path): result_path is the file minisat writes its model to, or None if the
+    solver prints its result on stdout.
+    """
+    result = os.path.join(workdir, member.name + '.res')
+    if member.kind == 'kissat':
+        # kissat reads stdin when it gets no file, it does not accept '-' or /dev/stdin for a pipe
+        return [paths.kissat, *member.options, *([cnf] if cnf else [])], None
+    cnf = cnf or '/dev/stdin'
+    if member.kind == 'minisat':
+        return [paths.minisat, *member.options, cnf, result], result
+    if member.kind == 'satelite':
+        # SatELite exits with 10/20 if preprocessing already decides the formula
+        files = SatEliteFiles(workdir, member.name)
+        script = ('"$0" "$1" "$2" "$3" "$4" >/dev/null 2>&1; rc=$?; '
+                  '[ $rc -eq 0 ] || exit $rc; exec "$5" "$2" "$6" >/dev/null 2>&1')
+        return ['sh', '-c', script, paths.satelite, cnf, files.cnf, files.vmap, files.elim,
+                paths.minisat, result], result
+    raise ValueError(f"unknown solver kind '{member.kind}'")
+
+
+def minisat_to_kissat(result_path, code):
+    """Convert a minisat result file ("SAT" and a model line) to kissat style output."""
+    model = []
+    if code == SAT and os.path.exists(result_path):
+        with open(result_path) as f:
+            f.readline()
+            model = [int(x) for x in f.readline().split() if x != '0']
+    return model_lines(model, code)
+
+
+def kissat_to_minisat(text, code):
+    """Convert kissat output to the minisat result format that SatELite +ext reads."""
+    if code != SAT:
+        return 'UNSAT\n' if code == UNSAT else 'INDET\n'
+    return 'SAT\n' + ' '.join(map(str, parse_model(text))) + ' 0\n'
+
+
+def model_lines(lits, code):
+    """Kissat style output for a status and a model."""
+    lines = [STATUS_LINES.get(code, 's UNKNOWN')]
+    lits = list(lits)
+    if code == SAT:
+        lines.extend('v ' + ' '.join(map(str, lits[i:i + 16])) for i in range(0, len(lits), 16))
+        lines.append('v 0')
+    return '\n'.join(lines) + '\n'
+
+
+class SatEliteFiles:
+    """The three outputs of a SatELite preprocessing run inside a work directory."""
+
+    def __init__(self, workdir, prefix='satelite'):
+        self.cnf = os.path.join(workdir, prefix + '.pre.cnf')
+        self.vmap = os.path.join(workdir, prefix + '.var')
+        self.elim = os.path.join(workdir, prefix + '.elim')
+        self.model = os.path.join(workdir, prefix + '.model')
+
+
+def satelite_preprocess(paths, cnf, files, pass_fds=()):
+    """
+    Run SatELite as preprocessor.
+    @return 0 if files.cnf holds the reduced formula, SAT or UNSAT if preprocessing decided it already.
+    """
+    proc = subprocess.run([paths.satelite, cnf, files.cnf, files.vmap, files.elim],
+                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, pass_fds=pass_fds)
+    if proc.returncode not in (0, SAT, UNSAT):
+        raise RuntimeError(f"SatELite failed (exit code {proc.returncode})")
+    return proc.returncode
+
+
+def satelite_extend(paths, cnf, files, result_path, pass_fds=()):
+    """
+    Extend a model of the reduced formula (minisat result file) to the original variables with
+    SatELite +ext, which reverses the renaming of the var map and fixes the eliminated variables from the
+    eliminated clauses. SatELite also checks the extended model against the original CNF.
+    @return The literals of the full model.
+    """
+    proc = subprocess.run([paths.satelite, '+ext', '+mod=' + files.model, cnf, result_path, files.vmap,
+                           files.elim], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, pass_fds=pass_fds)
+    if proc.returncode != SAT or not os.path.exists(files.model):
+        raise RuntimeError(f"SatELite could not extend the model (exit code {proc.returncode})")
+    with open(files.model) as f:
+        return [int(x) for x in f.read().split() if x != '0']
+
+
+def solve_preprocessed(paths, cnf, sol_path, pass_fds=()):
+    """
+    Preprocess with SatELite, solve the reduced formula with kissat and extend its model to the original
+    variables. The output in sol_path is in kissat format with the full model.
+    @return (exit code, {'preprocess': s, 'solve': s, 'extend': s}) with the seconds of each stage.
+    """
+    times = {'preprocess': 0.0, 'solve': 0.0, 'extend': 0.0}
+    with tempfile.TemporaryDirectory(prefix='satelite-') as workdir:
+        files = SatEliteFiles(workdir)
+        start = time.monotonic()
+        code = satelite_preprocess(paths, cnf, files, pass_fds)
+        times['preprocess'] = time.monotonic() - start
+        if code == UNSAT:
+            with open(sol_path, 'w') as sol_f:
+                sol_f.write(model_lines((), UNSAT))
+            return code, times
+        if code == SAT:
+            # decided during preprocessing, kissat on the original formula delivers a model quickly
+            start = time.monotonic()
+            with open(sol_path, 'w') as sol_f:
+                code = subprocess.run([paths.kissat, cnf], stdout=sol_f, stderr=subprocess.DEVNULL,
+                                      pass_fds=pass_fds).returncode
+            times['solve'] = time.monotonic() - start
+            return code, times
+
+        start = time.monotonic()
+        proc = subprocess.run([paths.kissat, files.cnf], stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                              text=True)
+        code = proc.returncode
+        times['solve'] = time.monotonic() - start
+        if code != SAT:
+            with open(sol_path, 'w') as sol_f:
+                sol_f.write(model_lines((), code))
+            return code, times
+
+        start = time.monotonic()
+        result_path = os.path.join(workdir, 'kissat.res')
+        with open(result_path, 'w') as f:
+            f.write(kissat_to_minisat(proc.stdout, code))
+        model = satelite_extend(paths, cnf, files, result_path, pass_fds)
+        times['extend'] = time.monotonic() - start
+        with open(sol_path, 'w') as sol_f:
+            sol_f.write(model_lines(model, SAT))
+    return code, times
+
+
+def race(members, paths, cnf, sol_path, pass_fds=(), stdins=None, feeder=None):
+    """
+    Run all members on cnf at once, each pinned to its own core (round robin if there are fewer cores
+    than members) and in its own process group. The first member finishing with SAT or UNSAT wins and
+    all others are killed. The normalized output of the winner is written to sol_path.
+    @param cnf Path of the CNF, e.g. /proc/self/fd/N for a descriptor listed in pass_fds, or None if
+    member i reads it from the descriptor stdins[i].
+    @param feeder Called once all members run; may return a Popen (e.g. the encoder writing the stdins)
+    whose exit status is then collected here, read it with its wait() afterwards.
+    @return (winner name or None, exit code, wall clock seconds, rusage of the winner or None).
+    """
+    cpus = sorted(os.sched_getaffinity(0))
+    start = time.monotonic()
+    with tempfile.TemporaryDirectory(prefix='portfolio-') as workdir:
+        running = {}
+        started = {}
+        for i, member in enumerate(members):
+            argv, result_path = member_command(member, paths, cnf, workdir)
+            out_path = os.path.join(workdir, member.name + '.out')
+            cpu = cpus[i % len(cpus)]
+            with open(out_path, 'w') as out:
+                proc = subprocess.Popen(argv, stdin=stdins[i] if stdins else None, stdout=out,
+                                        stderr=subprocess.DEVNULL, pass_fds=pass_fds, start_new_session=True,
+                                        preexec_fn=lambda cpu=cpu: os.sched_setaffinity(0, {cpu}))
+            running[proc.pid] = (member, proc, out_path, result_path)
+            started[proc.pid] = time.monotonic()
+
+        others = {}
+        if feeder is not None:
+            proc = feeder()
+            if proc is not None:
+                others[proc.pid] = proc
+
+        winner, code, usage = None, UNKNOWN, None
+        try:
+            while running:
+                pid, status, rusage = os.wait4(-1, 0)
+                if pid in others:
+                    others.pop(pid).returncode = os.waitstatus_to_exitcode(status)
+                if pid not in running:
+                    continue
+                member, proc, out_path, result_path = running.pop(pid)
+                proc.returncode = os.waitstatus_to_exitcode(status)
+                phaselog.trace.span('race', started[pid], pid=pid, process=member.name, exit=proc.returncode)
+                if proc.returncode in (SAT, UNSAT):
+                    winner, code, usage = member, proc.returncode, rusage
+                    break
+            elapsed = time.monotonic() - start
+        finally:
+            # also on KeyboardInterrupt or SystemExit: members run in their own sessions and would survive
+            for pid, (member, proc, _, _) in running.items():
+                try:
+                    os.killpg(pid, signal.SIGKILL)
+                except ProcessLookupError:
+                    pass
+                proc.wait()
+                phaselog.trace.span('race', started[pid], pid=pid, process=member.name, killed=True)
+
+        if winner is not None:
+            if result_path is None:
+                with open(out_path) as f:
+                    text = f.read()
+            elif winner.kind == 'satelite' and code == SAT and os.path.exists(result_path):
+                # the minisat model assigns the variables of the reduced formula
+                files = SatEliteFiles(workdir, winner.name)
+                try:
+                    text = model_lines(satelite_extend(paths, cnf or '/dev/null', files, result_path, pass_fds),
+                                       SAT)
+                except RuntimeError:
+                    text = model_lines((), SAT)
+            else:
+                text = minisat_to_kissat(result_path, code)
+            with open(sol_path, 'w') as sol_f:
+                sol_f.write(text)
+    return (winner.name if winner else None), code, elapsed, usage
+
+
+def record_win(log_path, instance, k, members, winner, code, elapsed):
+    """Append one race result to a CSV log, used to find members that never win."""
+    new = not os.path.exists(log_path)
+    with open(log_path, 'a') as log:
+        if new:
+            log.write('instance,k,winner,result,seconds,members\n')
+        result = {SAT: 'SAT', UNSAT: 'UNSAT'}.get(code, 'UNKNOWN')
+        log.write(f"{instance},{k},{winner or ''},{result},{elapsed:.3f},{' '.join(m.name for m in members)}\n")
+
+
+def instance_family(name):
+    """Family of an instance name: its leading letters, e.g. 'le' for le450_15a or 'flat' for flat300_20_0."""
+    letters = name.lstrip('0123456789')
+    end = 0
+    while end < len(letters) and letters[end].isalpha():
+        end += 1
+    return letters[:end] or name
+
+
+def record_preprocess(log_path, instance, k, mode, code, times):
+    """Append the stage times of one run with (mode 'satelite') or without (mode 'none') preprocessing."""
+    new = not os.path.exists(log_path)
+    with open(log_path, 'a') as log:
+        if new:
+            log.write('family,instance,k,mode,result,preprocess,solve,extend,total\n')
+        result = {SAT: 'SAT', UNSAT: 'UNSAT'}.get(code, 'UNKNOWN')
+        log.write(f"{instance_family(instance)},{instance},{k},{mode},{result},{times.get('preprocess', 0):.3f},"
+                  f"{times.get('solve', 0):.3f},{times.get('extend', 0):.3f},{sum(times.values()):.3f}\n")
+
+
+def choose_preprocess(log_path, instance):
+    """
+    Decide from the preprocessing log whether SatELite pays off for the family of instance: the mode with
+    the lower median total time among decided runs wins. A mode without any run of this family is tried
+    first, so both get measured.
+    @return 'satelite' or 'none'.
+    """
+    family = instance_family(instance)
+    totals = {'none': [], 'satelite': []}
+    if os.path.exists(log_path):
+        with open(log_path) as log:
+            log.readline()
+            for line in log:
+                fields = line.rstrip('\n').split(',')
+                if len(fields) == 9 and fields[0] == family and fields[3] in totals and fields[4] != 'UNKNOWN':
+                    totals[fields[3]].append(float(fields[8]))
+    for mode in ('satelite', 'none'):
+        if not totals[mode]:
+            return mode
+
+    def median(xs):
+        xs = sorted(xs)
+        return (xs[(len(xs) - 1) // 2] + xs[len(xs) // 2]) / 2
+    return 'satelite' if median(totals['satelite']) < median(totals['none']) else 'none'